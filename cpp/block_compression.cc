@@ -0,0 +1,324 @@
+#include "block_compression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// A 4x4 block with color in structure-of-arrays order, so that four pixels fit one SSE register.
+struct Block {
+  alignas(16) float r[16];
+  alignas(16) float g[16];
+  alignas(16) float b[16];
+  unsigned char a[16];
+};
+
+void loadBlock(const TextureImage &image, int bx, int by, Block &block) {
+  for (int y = 0; y < 4; y++) {
+    for (int x = 0; x < 4; x++) {
+      int px = std::min(bx * 4 + x, image.width - 1);
+      int py = std::min(by * 4 + y, image.height - 1);
+      const unsigned char *p = &image.pixels[((size_t)py * image.width + px) * image.channels];
+      int i = y * 4 + x;
+      bool gray = image.channels < 3;
+      block.r[i] = p[0];
+      block.g[i] = gray ? p[0] : p[1];
+      block.b[i] = gray ? p[0] : p[2];
+      block.a[i] = image.channels == 4 ? p[3] : 255;
+    }
+  }
+}
+
+uint16_t packColor(const float c[3]) {
+  auto quantize = [](float v, int max) {
+    return (int)std::clamp(v * max / 255.0f + 0.5f, 0.0f, (float)max);
+  };
+  return (uint16_t)(quantize(c[0], 31) << 11 | quantize(c[1], 63) << 5 | quantize(c[2], 31));
+}
+
+// Expands to 8 bits per channel the way decoders do, by replicating the high bits.
+void unpackColor(uint16_t packed, float c[3]) {
+  int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+  c[0] = (float)(r << 3 | r >> 2);
+  c[1] = (float)(g << 2 | g >> 4);
+  c[2] = (float)(b << 3 | b >> 2);
+}
+
+// Fills the four-color palette in BC1 index order: c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1.
+void buildPalette(uint16_t c0, uint16_t c1, float palette[4][3]) {
+  unpackColor(c0, palette[0]);
+  unpackColor(c1, palette[1]);
+  for (int k = 0; k < 3; k++) {
+    palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+    palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+  }
+}
+
+/** Picks the nearest palette entry for every pixel. Returns the total squared error. */
+float selectIndices(const Block &block, const float palette[4][3], uint32_t &indices) {
+  indices = 0;
+  float error = 0;
+#if defined(__SSE2__)
+  for (int i = 0; i < 16; i += 4) {
+    __m128 r = _mm_load_ps(block.r + i), g = _mm_load_ps(block.g + i), b = _mm_load_ps(block.b + i);
+    __m128 best = _mm_set1_ps(INFINITY);
+    __m128i best_index = _mm_setzero_si128();
+    for (int p = 0; p < 4; p++) {
+      __m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[p][0]));
+      __m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[p][1]));
+      __m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[p][2]));
+      __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+      __m128i closer = _mm_castps_si128(_mm_cmplt_ps(d, best));
+      best = _mm_min_ps(d, best);
+      best_index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)),
+                                _mm_andnot_si128(closer, best_index));
+    }
+    alignas(16) int32_t lane_index[4];
+    alignas(16) float lane_error[4];
+    _mm_store_si128((__m128i *)lane_index, best_index);
+    _mm_store_ps(lane_error, best);
+    for (int j = 0; j < 4; j++) {
+      indices |= (uint32_t)lane_index[j] << (2 * (i + j));
+      error += lane_error[j];
+    }
+  }
+#else
+  for (int i = 0; i < 16; i++) {
+    float best = INFINITY;
+    uint32_t best_index = 0;
+    for (int p = 0; p < 4; p++) {
+      float dr = block.r[i] - palette[p][0], dg = block.g[i] - palette[p][1],
+            db = block.b[i] - palette[p][2];
+      float d = dr * dr + dg * dg + db * db;
+      if (d < best) {
+        best = d;
+        best_index = p;
+      }
+    }
+    indices |= best_index << (2 * i);
+    error += best;
+  }
+#endif
+  return error;
+}
+
+/**
+ * Picks initial endpoints as the two pixels furthest apart along the principal axis of the block's
+ * colors, found by power iteration on their covariance.
+ */
+void fitEndpoints(const Block &block, float c0[3], float c1[3]) {
+  float mean[3] = {0, 0, 0};
+  for (int i = 0; i < 16; i++) {
+    mean[0] += block.r[i];
+    mean[1] += block.g[i];
+    mean[2] += block.b[i];
+  }
+  for (float &m : mean) {
+    m /= 16;
+  }
+  float cov[6] = {0, 0, 0, 0, 0, 0}; // rr, rg, rb, gg, gb, bb
+  for (int i = 0; i < 16; i++) {
+    float r = block.r[i] - mean[0], g = block.g[i] - mean[1], b = block.b[i] - mean[2];
+    cov[0] += r * r;
+    cov[1] += r * g;
+    cov[2] += r * b;
+    cov[3] += g * g;
+    cov[4] += g * b;
+    cov[5] += b * b;
+  }
+  float axis[3] = {1, 1, 1};
+  for (int iteration = 0; iteration < 8; iteration++) {
+    float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+    float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+    float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+    float length = std::max({std::fabs(x), std::fabs(y), std::fabs(z)});
+    if (length < 1e-6f) {
+      break; // Flat block; any axis will do.
+    }
+    axis[0] = x / length;
+    axis[1] = y / length;
+    axis[2] = z / length;
+  }
+
+  int lo = 0, hi = 0;
+  float lo_dot = INFINITY, hi_dot = -INFINITY;
+  for (int i = 0; i < 16; i++) {
+    float dot = block.r[i] * axis[0] + block.g[i] * axis[1] + block.b[i] * axis[2];
+    if (dot < lo_dot) {
+      lo_dot = dot;
+      lo = i;
+    }
+    if (dot > hi_dot) {
+      hi_dot = dot;
+      hi = i;
+    }
+  }
+  c0[0] = block.r[hi], c0[1] = block.g[hi], c0[2] = block.b[hi];
+  c1[0] = block.r[lo], c1[1] = block.g[lo], c1[2] = block.b[lo];
+}
+
+/**
+ * Solves for the endpoints that minimize the squared error of the given index assignment. Returns
+ * false if the assignment does not determine both endpoints.
+ */
+bool refineEndpoints(const Block &block, uint32_t indices, float c0[3], float c1[3]) {
+  static const float kWeights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+  float aa = 0, ab = 0, bb = 0, ax[3] = {0, 0, 0}, bx[3] = {0, 0, 0};
+  for (int i = 0; i < 16; i++) {
+    float w = kWeights[(indices >> (2 * i)) & 3], v = 1 - w;
+    aa += w * w;
+    ab += w * v;
+    bb += v * v;
+    float x[3] = {block.r[i], block.g[i], block.b[i]};
+    for (int k = 0; k < 3; k++) {
+      ax[k] += w * x[k];
+      bx[k] += v * x[k];
+    }
+  }
+  float det = aa * bb - ab * ab;
+  if (std::fabs(det) < 1e-6f) {
+    return false;
+  }
+  for (int k = 0; k < 3; k++) {
+    c0[k] = (bb * ax[k] - ab * bx[k]) / det;
+    c1[k] = (aa * bx[k] - ab * ax[k]) / det;
+  }
+  return true;
+}
+
+/** Quantizes endpoints and picks indices for them, in four-color mode (c0 > c1). */
+float encodeColors(const Block &block, const float c0[3], const float c1[3], uint16_t &p0,
+                   uint16_t &p1, uint32_t &indices) {
+  p0 = packColor(c0);
+  p1 = packColor(c1);
+  if (p0 < p1) {
+    std::swap(p0, p1);
+  }
+  float palette[4][3];
+  buildPalette(p0, p1, palette);
+  float error = selectIndices(block, palette, indices);
+  if (p0 == p1) {
+    // Equal endpoints would select three-color mode; every index is equivalent anyway.
+    indices = 0;
+  }
+  return error;
+}
+
+void encodeColorBlock(const Block &block, unsigned char *out) {
+  float c0[3], c1[3];
+  fitEndpoints(block, c0, c1);
+  uint16_t p0, p1;
+  uint32_t indices;
+  float error = encodeColors(block, c0, c1, p0, p1, indices);
+
+  // One least-squares pass over the chosen indices usually recovers most of the quantization loss.
+  if (refineEndpoints(block, indices, c0, c1)) {
+    uint16_t q0, q1;
+    uint32_t refined;
+    if (encodeColors(block, c0, c1, q0, q1, refined) < error) {
+      p0 = q0, p1 = q1, indices = refined;
+    }
+  }
+
+  out[0] = p0 & 0xFF;
+  out[1] = p0 >> 8;
+  out[2] = p1 & 0xFF;
+  out[3] = p1 >> 8;
+  for (int i = 0; i < 4; i++) {
+    out[4 + i] = (indices >> (8 * i)) & 0xFF;
+  }
+}
+
+// BC3 alpha in eight-value mode: a0 = max, a1 = min and six evenly spaced values in between.
+void encodeAlphaBlock(const Block &block, unsigned char *out) {
+  int a0 = *std::max_element(block.a, block.a + 16), a1 = *std::min_element(block.a, block.a + 16);
+  int palette[8] = {a0, a1};
+  for (int i = 2; i < 8; i++) {
+    palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+  }
+  uint64_t indices = 0;
+  if (a0 != a1) {
+    for (int i = 0; i < 16; i++) {
+      int best = 0;
+      for (int p = 1; p < 8; p++) {
+        if (std::abs(block.a[i] - palette[p]) < std::abs(block.a[i] - palette[best])) {
+          best = p;
+        }
+      }
+      indices |= (uint64_t)best << (3 * i);
+    }
+  }
+  out[0] = a0;
+  out[1] = a1;
+  for (int i = 0; i < 6; i++) {
+    out[2 + i] = (indices >> (8 * i)) & 0xFF;
+  }
+}
+
+size_t blockSize(BlockFormat format) { return format == BlockFormat::kBC1 ? 8 : 16; }
+
+} // namespace
+
+BlockFormat BlockFormatFor(const TextureImage &image) {
+  if (image.channels == 4) {
+    for (size_t i = 3; i < image.pixels.size(); i += 4) {
+      if (image.pixels[i] != 255) {
+        return BlockFormat::kBC3;
+      }
+    }
+  }
+  return BlockFormat::kBC1;
+}
+
+unsigned int BlockInternalFormat(BlockFormat format) {
+  return format == BlockFormat::kBC1 ? kCompressedRgbS3tcDxt1 : kCompressedRgbaS3tcDxt5;
+}
+
+size_t CompressedImageSize(BlockFormat format, int width, int height) {
+  return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockSize(format);
+}
+
+std::vector<unsigned char> CompressImage(const TextureImage &image, BlockFormat format,
+                                         unsigned int threads) {
+  int blocks_x = (image.width + 3) / 4, blocks_y = (image.height + 3) / 4;
+  size_t block_size = blockSize(format);
+  std::vector<unsigned char> result(CompressedImageSize(format, image.width, image.height));
+
+  auto encodeRows = [&](int first_row, int end_row) {
+    Block block;
+    for (int by = first_row; by < end_row; by++) {
+      for (int bx = 0; bx < blocks_x; bx++) {
+        unsigned char *out = &result[((size_t)by * blocks_x + bx) * block_size];
+        loadBlock(image, bx, by, block);
+        if (format == BlockFormat::kBC3) {
+          encodeAlphaBlock(block, out);
+          out += 8;
+        }
+        encodeColorBlock(block, out);
+      }
+    }
+  };
+
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threads = std::min(threads, (unsigned int)blocks_y);
+  if (threads <= 1) {
+    encodeRows(0, blocks_y);
+    return result;
+  }
+  std::vector<std::thread> workers;
+  for (unsigned int t = 0; t < threads; t++) {
+    workers.emplace_back(encodeRows, blocks_y * t / threads, blocks_y * (t + 1) / threads);
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  return result;
+}
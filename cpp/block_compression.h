@@ -0,0 +1,34 @@
+#ifndef LEARNOPENGL_BLOCK_COMPRESSION_H
+#define LEARNOPENGL_BLOCK_COMPRESSION_H
+
+#include <cstddef>
+#include <vector>
+
+#include "texture_file.h"
+
+// Internal formats from EXT_texture_compression_s3tc, which glad does not define.
+constexpr unsigned int kCompressedRgbS3tcDxt1 = 0x83F0;
+constexpr unsigned int kCompressedRgbaS3tcDxt5 = 0x83F3;
+
+enum class BlockFormat {
+  kBC1, // RGB, 8 bytes per 4x4 block.
+  kBC3, // RGBA, 16 bytes per 4x4 block: BC1 color plus interpolated alpha.
+};
+
+/** Picks BC1 for images without alpha and BC3 otherwise. */
+BlockFormat BlockFormatFor(const TextureImage &image);
+
+/** The GL internal format to upload blocks of this format with. */
+unsigned int BlockInternalFormat(BlockFormat format);
+
+size_t CompressedImageSize(BlockFormat format, int width, int height);
+
+/**
+ * Encodes an image with 1, 3 or 4 channels into 4x4 blocks. Partial blocks at the right and bottom
+ * edges repeat the last row and column. Rows of blocks are split across threads; zero threads
+ * means one per hardware thread.
+ */
+std::vector<unsigned char> CompressImage(const TextureImage &image, BlockFormat format,
+                                         unsigned int threads = 0);
+
+#endif // LEARNOPENGL_BLOCK_COMPRESSION_H
@@ -0,0 +1,410 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+namespace {
+
+constexpr int kBins = 16;
+// Nodes with more objects are always split, so no leaf has to test more than this many.
+constexpr uint32_t kMaxLeafObjects = 4;
+// Visiting a node, relative to testing one object's box.
+constexpr float kTraversalCost = 1.0f;
+// Smaller subtrees are built by the thread that split their parent.
+constexpr uint32_t kParallelSubtreeObjects = 4 * 1024;
+// Smaller nodes are binned on one thread.
+constexpr uint32_t kParallelBinObjects = 64 * 1024;
+
+struct Bin {
+  Aabb bounds;
+  // Of the objects' centers, which the children's bins are placed over in turn.
+  Aabb centers;
+  uint32_t count = 0;
+
+  void Grow(const Bin &other) {
+    bounds.Grow(other.bounds);
+    centers.Grow(other.centers);
+    count += other.count;
+  }
+};
+using Bins = std::array<std::array<Bin, kBins>, 3>;
+
+// Spreads kBins bins evenly over a node's object centers, per axis.
+struct Binning {
+  glm::vec3 min;
+  // Bins per unit along each axis, or zero if every center is at the same place along it.
+  glm::vec3 scale;
+
+  explicit Binning(const Aabb &centers) : min(centers.min) {
+    glm::vec3 extent = centers.max - centers.min;
+    for (int axis = 0; axis < 3; axis++) {
+      float scale_axis = extent[axis] > 0.0f ? kBins / extent[axis] : 0.0f;
+      scale[axis] = std::isfinite(scale_axis) ? scale_axis : 0.0f;
+    }
+  }
+
+  int Of(const glm::vec3 &center, int axis) const {
+    return std::min(kBins - 1, (int)((center[axis] - min[axis]) * scale[axis]));
+  }
+};
+
+// What the build partitions: each object's box and center travel with it, so binning a node
+// reads memory in order rather than jumping around the objects' boxes.
+struct BuildObject {
+  Aabb bounds;
+  glm::vec3 center;
+  uint32_t object;
+};
+
+struct BuildState {
+  std::vector<BuildObject> &objects;
+  std::vector<Bvh::Node> &nodes;
+  // Nodes are allocated in pairs from here, by whichever thread splits their parent.
+  std::atomic<uint32_t> node_count{1};
+};
+
+void binRange(const BuildState &state, const Binning &binning, size_t first, size_t last,
+              Bins *bins) {
+  for (size_t i = first; i < last; i++) {
+    const BuildObject &object = state.objects[i];
+    for (int axis = 0; axis < 3; axis++) {
+      if (binning.scale[axis] == 0.0f) {
+        continue;
+      }
+      Bin &bin = (*bins)[axis][binning.Of(object.center, axis)];
+      bin.bounds.Grow(object.bounds);
+      bin.centers.Grow(object.center);
+      bin.count++;
+    }
+  }
+}
+
+Bins binObjects(const BuildState &state, const Binning &binning, uint32_t first, uint32_t count,
+                unsigned int threads) {
+  Bins bins;
+  if (threads <= 1 || count < kParallelBinObjects) {
+    binRange(state, binning, first, first + count, &bins);
+    return bins;
+  }
+  std::vector<Bins> partial(threads);
+  auto slice = [&](unsigned int t) { return first + (size_t)count * t / threads; };
+  std::vector<std::thread> workers;
+  for (unsigned int t = 1; t < threads; t++) {
+    workers.emplace_back(
+        [&, t]() { binRange(state, binning, slice(t), slice(t + 1), &partial[t]); });
+  }
+  binRange(state, binning, slice(0), slice(1), &partial[0]);
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  for (const Bins &part : partial) {
+    for (int axis = 0; axis < 3; axis++) {
+      for (int bin = 0; bin < kBins; bin++) {
+        bins[axis][bin].Grow(part[axis][bin]);
+      }
+    }
+  }
+  return bins;
+}
+
+// Splits a node in two where the surface area heuristic is lowest, unless it is cheaper as a
+// leaf, and recurses into the children. centers bounds the centers of the node's objects.
+void subdivide(BuildState &state, uint32_t node_index, const Aabb &centers,
+               unsigned int threads) {
+  Bvh::Node &node = state.nodes[node_index];
+  uint32_t first = node.first, count = node.count;
+  if (count <= 1) {
+    return;
+  }
+
+  Binning binning(centers);
+  Bins bins = binObjects(state, binning, first, count, threads);
+  // The cost of a split is the area of each side times its objects; the lowest wins.
+  float best_cost = std::numeric_limits<float>::max();
+  int best_axis = -1, best_split = 0;
+  for (int axis = 0; axis < 3; axis++) {
+    if (binning.scale[axis] == 0.0f) {
+      continue;
+    }
+    std::array<float, kBins> right_cost;
+    Bin right;
+    for (int split = kBins - 1; split > 0; split--) {
+      right.Grow(bins[axis][split]);
+      right_cost[split] = right.bounds.SurfaceArea() * right.count;
+    }
+    Bin left;
+    for (int split = 1; split < kBins; split++) {
+      left.Grow(bins[axis][split - 1]);
+      if (left.count == 0 || left.count == count) {
+        continue;
+      }
+      float cost = left.bounds.SurfaceArea() * left.count + right_cost[split];
+      if (cost < best_cost) {
+        best_cost = cost, best_axis = axis, best_split = split;
+      }
+    }
+  }
+  // Relative to a leaf, which tests every object.
+  float area = node.bounds.SurfaceArea();
+  float split_cost = area > 0.0f ? kTraversalCost + best_cost / area : (float)count;
+  if (count <= kMaxLeafObjects && (best_axis < 0 || split_cost >= count)) {
+    return;
+  }
+
+  uint32_t middle;
+  Bin left, right;
+  if (best_axis >= 0) {
+    auto begin = state.objects.begin() + first;
+    middle = (uint32_t)(std::partition(begin, begin + count,
+                                       [&](const BuildObject &object) {
+                                         return binning.Of(object.center, best_axis) < best_split;
+                                       }) -
+                        state.objects.begin());
+    for (int bin = 0; bin < kBins; bin++) {
+      (bin < best_split ? left : right).Grow(bins[best_axis][bin]);
+    }
+  } else {
+    // Every center is in the same place, so any split is as good as another; halve the node to
+    // keep leaves small.
+    middle = first + count / 2;
+    for (uint32_t i = first; i < first + count; i++) {
+      (i < middle ? left : right).bounds.Grow(state.objects[i].bounds);
+    }
+    left.centers = right.centers = centers;
+  }
+
+  uint32_t child = state.node_count.fetch_add(2);
+  state.nodes[child] = {left.bounds, first, middle - first};
+  state.nodes[child + 1] = {right.bounds, middle, first + count - middle};
+  node.first = child;
+  node.count = 0;
+
+  if (threads > 1 && count >= kParallelSubtreeObjects) {
+    std::thread worker([&]() { subdivide(state, child, left.centers, threads / 2); });
+    subdivide(state, child + 1, right.centers, threads - threads / 2);
+    worker.join();
+  } else {
+    subdivide(state, child, left.centers, 1);
+    subdivide(state, child + 1, right.centers, 1);
+  }
+}
+
+// Whether box may be inside the planes of frustum set in *planes. Clears the planes it is
+// entirely inside of, which then need not be tested for anything within it.
+bool intersects(const Frustum &frustum, const Aabb &box, uint32_t *planes) {
+  glm::vec3 center = box.Center(), extent = box.Extent();
+  for (int i = 0; i < 6; i++) {
+    if ((*planes & (1u << i)) == 0) {
+      continue;
+    }
+    const glm::vec4 &plane = frustum.Plane(i);
+    glm::vec3 normal(plane.x, plane.y, plane.z);
+    float distance = glm::dot(normal, center) + plane.w;
+    float reach = glm::dot(glm::abs(normal), extent);
+    if (distance < -reach) {
+      return false;
+    }
+    if (distance >= reach) {
+      *planes &= ~(1u << i);
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+Aabb Aabb::Transformed(const glm::mat4 &matrix) const {
+  if (Empty()) {
+    return *this;
+  }
+  // Each axis of the box maps to a column of the matrix; the new extent along an axis is the sum
+  // of how far each of them reaches along it.
+  glm::vec3 extent = Extent();
+  glm::vec3 center = glm::vec3(matrix * glm::vec4(Center(), 1.0f));
+  glm::vec3 reach(0.0f);
+  for (int axis = 0; axis < 3; axis++) {
+    reach += glm::abs(glm::vec3(matrix[axis])) * extent[axis];
+  }
+  return {center - reach, center + reach};
+}
+
+float Aabb::RayEntry(const glm::vec3 &origin, const glm::vec3 &inverse_direction) const {
+  // Where the ray crosses each pair of slabs; it is inside the box where it is inside all three.
+  glm::vec3 t0 = (min - origin) * inverse_direction, t1 = (max - origin) * inverse_direction;
+  glm::vec3 near = glm::min(t0, t1), far = glm::max(t0, t1);
+  float entry = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+  float exit = std::min(std::min(far.x, far.y), far.z);
+  return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+}
+
+void Bvh::Build(const std::vector<Aabb> &bounds, unsigned int threads) {
+  bounds_ = bounds;
+  uint32_t count = (uint32_t)bounds.size();
+  objects_.resize(count);
+  nodes_.clear();
+  parents_.clear();
+  leaves_.assign(count, 0);
+  if (count == 0) {
+    return;
+  }
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  std::vector<BuildObject> objects(count);
+  Aabb root, root_centers;
+  for (uint32_t object = 0; object < count; object++) {
+    objects[object] = {bounds[object], bounds[object].Center(), object};
+    root.Grow(bounds[object]);
+    root_centers.Grow(objects[object].center);
+  }
+  // Every split makes two nodes and leaves are never empty, so there are at most 2n - 1.
+  nodes_.resize(2 * (size_t)count - 1);
+  nodes_[0] = {root, 0, count};
+  BuildState state{objects, nodes_};
+  subdivide(state, 0, root_centers, threads);
+  nodes_.resize(state.node_count);
+  for (uint32_t i = 0; i < count; i++) {
+    objects_[i] = objects[i].object;
+  }
+
+  parents_.assign(nodes_.size(), 0);
+  for (uint32_t i = 0; i < nodes_.size(); i++) {
+    const Node &node = nodes_[i];
+    if (node.Leaf()) {
+      for (uint32_t j = node.first; j < node.first + node.count; j++) {
+        leaves_[objects_[j]] = i;
+      }
+    } else {
+      parents_[node.first] = parents_[node.first + 1] = i;
+    }
+  }
+}
+
+void Bvh::Update(uint32_t object, const Aabb &bounds) {
+  bounds_[object] = bounds;
+  uint32_t node = leaves_[object];
+  while (true) {
+    Aabb fitted = Fit(nodes_[node]);
+    if (fitted == nodes_[node].bounds) {
+      // Nothing above depends on anything but this box.
+      return;
+    }
+    nodes_[node].bounds = fitted;
+    if (node == 0) {
+      return;
+    }
+    node = parents_[node];
+  }
+}
+
+void Bvh::Refit(const std::vector<Aabb> &bounds) {
+  bounds_ = bounds;
+  // Children come after their parents, so going backwards fits them first.
+  for (size_t i = nodes_.size(); i-- > 0;) {
+    nodes_[i].bounds = Fit(nodes_[i]);
+  }
+}
+
+Aabb Bvh::Fit(const Node &node) const {
+  Aabb fitted;
+  if (node.Leaf()) {
+    for (uint32_t i = node.first; i < node.first + node.count; i++) {
+      fitted.Grow(bounds_[objects_[i]]);
+    }
+  } else {
+    fitted.Grow(nodes_[node.first].bounds);
+    fitted.Grow(nodes_[node.first + 1].bounds);
+  }
+  return fitted;
+}
+
+size_t Bvh::Cull(const Frustum &frustum, std::vector<uint32_t> *objects) const {
+  if (nodes_.empty()) {
+    return 0;
+  }
+  size_t before = objects->size();
+  // Each node with the planes still to test, one bit per plane.
+  std::vector<std::pair<uint32_t, uint32_t>> stack = {{0, 0x3f}};
+  while (!stack.empty()) {
+    auto [index, planes] = stack.back();
+    stack.pop_back();
+    const Node &node = nodes_[index];
+    if (planes != 0 && !intersects(frustum, node.bounds, &planes)) {
+      continue;
+    }
+    if (!node.Leaf()) {
+      stack.push_back({node.first + 1, planes});
+      stack.push_back({node.first, planes});
+      continue;
+    }
+    for (uint32_t i = node.first; i < node.first + node.count; i++) {
+      uint32_t object_planes = planes;
+      if (planes == 0 || intersects(frustum, bounds_[objects_[i]], &object_planes)) {
+        objects->push_back(objects_[i]);
+      }
+    }
+  }
+  return objects->size() - before;
+}
+
+std::optional<Bvh::RayHit> Bvh::Raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                                        float max_distance, const RayTest &test) const {
+  if (nodes_.empty()) {
+    return std::nullopt;
+  }
+  glm::vec3 inverse = 1.0f / direction;
+  // Where the ray enters box, if it does before limit, or infinity.
+  auto enter = [&](const Aabb &box, float limit) {
+    float entry = box.RayEntry(origin, inverse);
+    return entry < limit ? entry : std::numeric_limits<float>::infinity();
+  };
+
+  std::optional<RayHit> hit;
+  float nearest = max_distance;
+  // Each node with where the ray enters it; the nearer child is popped first.
+  std::vector<std::pair<uint32_t, float>> stack;
+  float root_entry = enter(nodes_[0].bounds, nearest);
+  if (root_entry < nearest) {
+    stack.push_back({0, root_entry});
+  }
+  while (!stack.empty()) {
+    auto [index, entry] = stack.back();
+    stack.pop_back();
+    if (entry >= nearest) {
+      continue;
+    }
+    const Node &node = nodes_[index];
+    if (node.Leaf()) {
+      for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        uint32_t object = objects_[i];
+        float distance = enter(bounds_[object], nearest);
+        if (distance < nearest && test) {
+          distance = test(object, nearest).value_or(std::numeric_limits<float>::infinity());
+        }
+        if (distance < nearest) {
+          nearest = distance;
+          hit = RayHit{object, distance};
+        }
+      }
+      continue;
+    }
+    float left = enter(nodes_[node.first].bounds, nearest);
+    float right = enter(nodes_[node.first + 1].bounds, nearest);
+    uint32_t near_child = node.first, far_child = node.first + 1;
+    if (right < left) {
+      std::swap(left, right);
+      std::swap(near_child, far_child);
+    }
+    if (right < nearest) {
+      stack.push_back({far_child, right});
+    }
+    if (left < nearest) {
+      stack.push_back({near_child, left});
+    }
+  }
+  return hit;
+}
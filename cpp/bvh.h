@@ -0,0 +1,131 @@
+#ifndef LEARNOPENGL_BVH_H
+#define LEARNOPENGL_BVH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "frustum.h"
+
+/** An axis-aligned box. Default constructed it is empty, with min above max, until grown. */
+struct Aabb {
+  glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+  glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+  bool Empty() const { return min.x > max.x; }
+  glm::vec3 Center() const { return (min + max) * 0.5f; }
+  glm::vec3 Extent() const { return (max - min) * 0.5f; }
+  float SurfaceArea() const {
+    if (Empty()) {
+      return 0.0f;
+    }
+    glm::vec3 size = max - min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+  }
+
+  void Grow(const glm::vec3 &point) {
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+  }
+  void Grow(const Aabb &box) {
+    min = glm::min(min, box.min);
+    max = glm::max(max, box.max);
+  }
+
+  /** The box around this one once transformed by matrix, such as from model to world space. */
+  Aabb Transformed(const glm::mat4 &matrix) const;
+  /**
+   * How far along the ray from origin the box begins, in lengths of the ray's direction, or
+   * infinity if the ray misses it. Takes 1 / direction, so that a ray tested against many boxes
+   * divides once.
+   */
+  float RayEntry(const glm::vec3 &origin, const glm::vec3 &inverse_direction) const;
+
+  bool operator==(const Aabb &other) const { return min == other.min && max == other.max; }
+  bool operator!=(const Aabb &other) const { return !(*this == other); }
+};
+
+/**
+ * A bounding volume hierarchy over the boxes of a set of objects, so that frustum culling and ray
+ * casts visit the nodes along the way to what they find, O(log n) for a well spread scene,
+ * rather than every object.
+ *
+ * Build splits nodes where the surface area heuristic says rays and frusta are least likely to
+ * have to visit both children, choosing among 16 bins of object centers per axis. Large subtrees
+ * and the binning of large nodes run on several threads. When objects move, Update refits just
+ * the path above one object and Refit the whole tree, both keeping its shape; rebuild once the
+ * objects have moved far enough that the old split no longer suits them.
+ *
+ * Objects are numbered by their index in the boxes given to Build.
+ */
+class Bvh {
+public:
+  struct Node {
+    Aabb bounds;
+    // A leaf holds objects Objects()[first, first + count). An inner node has a count of zero
+    // and children first and first + 1, which always come after it.
+    uint32_t first = 0;
+    uint32_t count = 0;
+
+    bool Leaf() const { return count > 0; }
+  };
+
+  struct RayHit {
+    uint32_t object;
+    float distance;
+  };
+
+  /**
+   * Tests the ray against the object itself, returning the distance along it of the first hit,
+   * if any, closer than max_distance. Called only for objects whose box the ray hits.
+   */
+  using RayTest = std::function<std::optional<float>(uint32_t object, float max_distance)>;
+
+  /** Rebuilds the tree over bounds. Zero threads means one per hardware thread. */
+  void Build(const std::vector<Aabb> &bounds, unsigned int threads = 0);
+
+  /** Moves one object to bounds, refitting only the nodes above it, up to the first unchanged. */
+  void Update(uint32_t object, const Aabb &bounds);
+  /** Moves every object at once; cheaper than Update when many have moved. */
+  void Refit(const std::vector<Aabb> &bounds);
+
+  /**
+   * Appends the objects whose box may be inside the frustum to objects and returns how many.
+   * Subtrees entirely inside are taken whole without testing their objects.
+   */
+  size_t Cull(const Frustum &frustum, std::vector<uint32_t> *objects) const;
+
+  /**
+   * The nearest object the ray from origin along direction hits within max_distance. Without
+   * test, hitting an object's box counts as hitting the object; the distance is along direction,
+   * so in units of its length.
+   */
+  std::optional<RayHit> Raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                                float max_distance = std::numeric_limits<float>::max(),
+                                const RayTest &test = nullptr) const;
+
+  size_t ObjectCount() const { return bounds_.size(); }
+  const std::vector<Node> &Nodes() const { return nodes_; }
+  const std::vector<uint32_t> &Objects() const { return objects_; }
+  const Aabb &Bounds(uint32_t object) const { return bounds_[object]; }
+
+private:
+  // Recomputes a node's box from its objects or children.
+  Aabb Fit(const Node &node) const;
+
+  // The root is node 0, if there are any objects.
+  std::vector<Node> nodes_;
+  // Object numbers in leaf order.
+  std::vector<uint32_t> objects_;
+  // The box of each object.
+  std::vector<Aabb> bounds_;
+  // The parent of each node, and the leaf holding each object, for Update.
+  std::vector<uint32_t> parents_;
+  std::vector<uint32_t> leaves_;
+};
+
+#endif // LEARNOPENGL_BVH_H
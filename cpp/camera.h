@@ -51,7 +51,20 @@ public:
   void ProcessMouseScroll(double y) { zoom_ = std::clamp(zoom_ - (float)y, 0.0f, 45.0f); }
 
   /** Returns the field of view angle. */
-  float Zoom() { return zoom_; }
+  float Zoom() const { return zoom_; }
+
+  glm::vec3 Position() const { return position_; }
+
+  /**
+   * The unit direction of the ray from the camera through a point on the screen, given in
+   * normalized device coordinates, for a perspective projection of Zoom() degrees and aspect.
+   * (0, 0) is straight ahead.
+   */
+  glm::vec3 RayThrough(float x, float y, float aspect) const {
+    float tan_half_fov = std::tan(glm::radians(zoom_) * 0.5f);
+    return glm::normalize(front_ + right_ * (x * tan_half_fov * aspect) +
+                          up_ * (y * tan_half_fov));
+  }
 
 private:
   void UpdateCameraVectors() {
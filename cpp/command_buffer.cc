@@ -0,0 +1,286 @@
+#include "command_buffer.h"
+
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "instance_buffer.h"
+
+namespace {
+
+struct UseProgramCommand {
+  unsigned int program;
+  void Execute() const { glUseProgram(program); }
+};
+
+struct BindVertexArrayCommand {
+  unsigned int vao;
+  void Execute() const { glBindVertexArray(vao); }
+};
+
+struct BindTextureCommand {
+  unsigned int unit;
+  unsigned int texture;
+  GLenum target;
+  void Execute() const {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(target, texture);
+  }
+};
+
+struct BindBufferRangeCommand {
+  GLenum target;
+  unsigned int index;
+  unsigned int buffer;
+  size_t offset;
+  size_t size;
+  void Execute() const { glBindBufferRange(target, index, buffer, offset, size); }
+};
+
+struct UniformIntCommand {
+  int location;
+  int value;
+  void Execute() const { glUniform1i(location, value); }
+};
+
+struct UniformFloatCommand {
+  int location;
+  float value;
+  void Execute() const { glUniform1f(location, value); }
+};
+
+struct UniformMatrixCommand {
+  int location;
+  glm::mat4 value;
+  void Execute() const { glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value)); }
+};
+
+struct AttachInstancesCommand {
+  unsigned int vao;
+  unsigned int buffer;
+  size_t offset;
+  void Execute() const {
+    InstanceBuffer::Attach(vao, buffer, offset);
+    glBindVertexArray(vao);
+  }
+};
+
+struct DrawArraysCommand {
+  GLenum mode;
+  uint32_t first;
+  uint32_t count;
+  uint32_t instance_count;
+  void Execute() const {
+    glDrawArraysInstanced(mode, (GLint)first, (GLsizei)count, (GLsizei)instance_count);
+  }
+};
+
+struct DrawElementsCommand {
+  GLenum mode;
+  GLenum index_type;
+  uint32_t first;
+  uint32_t count;
+  int32_t base_vertex;
+  uint32_t instance_count;
+  void Execute() const {
+    glDrawElementsInstancedBaseVertex(mode, (GLsizei)count, index_type,
+                                      (void *)(first * IndexSize(index_type)),
+                                      (GLsizei)instance_count, base_vertex);
+  }
+};
+
+// Followed in the buffer by range_count offsets, then range_count counts.
+struct MultiDrawElementsHeader {
+  GLenum mode;
+  GLenum index_type;
+  uint32_t range_count;
+};
+// Keeps the offsets that follow 8-byte aligned.
+constexpr size_t kMultiDrawHeaderSize = (sizeof(MultiDrawElementsHeader) + 7) / 8 * 8;
+
+void executeMultiDrawElements(const unsigned char *payload) {
+  MultiDrawElementsHeader header;
+  std::memcpy(&header, payload, sizeof(header));
+  payload += kMultiDrawHeaderSize;
+  const auto *offsets = reinterpret_cast<const void *const *>(payload);
+  const auto *counts =
+      reinterpret_cast<const GLsizei *>(payload + header.range_count * sizeof(void *));
+  glMultiDrawElements(header.mode, counts, header.index_type, offsets,
+                      (GLsizei)header.range_count);
+}
+
+} // namespace
+
+void CommandBuffer::Reset() {
+  size_ = 0;
+  command_count_ = 0;
+  program_ = kUnknown;
+  vao_ = kUnknown;
+}
+
+void CommandBuffer::Execute() const {
+  const unsigned char *command = bytes_.data();
+  const unsigned char *end = command + size_;
+  while (command < end) {
+    Header header;
+    std::memcpy(&header, command, sizeof(header));
+    header.execute(command + sizeof(Header));
+    command += sizeof(Header) + header.size;
+  }
+}
+
+void *CommandBuffer::Append(ExecuteFunction execute, size_t size) {
+  size = (size + kAlignment - 1) / kAlignment * kAlignment;
+  size_t needed = size_ + sizeof(Header) + size;
+  if (needed > bytes_.size()) {
+    bytes_.resize(std::max(needed, bytes_.size() * 2));
+  }
+  Header header = {execute, size};
+  std::memcpy(bytes_.data() + size_, &header, sizeof(header));
+  void *payload = bytes_.data() + size_ + sizeof(Header);
+  size_ = needed;
+  command_count_++;
+  return payload;
+}
+
+void CommandBuffer::UseProgram(unsigned int program) {
+  if (program != program_) {
+    program_ = program;
+    Record(UseProgramCommand{program});
+  }
+}
+
+void CommandBuffer::BindVertexArray(unsigned int vao) {
+  if (vao != vao_) {
+    vao_ = vao;
+    Record(BindVertexArrayCommand{vao});
+  }
+}
+
+void CommandBuffer::BindTexture(unsigned int unit, unsigned int texture, GLenum target) {
+  Record(BindTextureCommand{unit, texture, target});
+}
+
+void CommandBuffer::BindBufferRange(GLenum target, unsigned int index, unsigned int buffer,
+                                    size_t offset, size_t size) {
+  Record(BindBufferRangeCommand{target, index, buffer, offset, size});
+}
+
+void CommandBuffer::SetUniform(int location, int value) {
+  Record(UniformIntCommand{location, value});
+}
+
+void CommandBuffer::SetUniform(int location, float value) {
+  Record(UniformFloatCommand{location, value});
+}
+
+void CommandBuffer::SetUniform(int location, const glm::mat4 &value) {
+  Record(UniformMatrixCommand{location, value});
+}
+
+void CommandBuffer::AttachInstances(unsigned int vao, unsigned int buffer, size_t offset) {
+  vao_ = vao;
+  Record(AttachInstancesCommand{vao, buffer, offset});
+}
+
+void CommandBuffer::DrawArrays(GLenum mode, uint32_t first, uint32_t count,
+                               uint32_t instance_count) {
+  Record(DrawArraysCommand{mode, first, count, instance_count});
+}
+
+void CommandBuffer::DrawElements(GLenum mode, GLenum index_type, uint32_t first, uint32_t count,
+                                 int32_t base_vertex, uint32_t instance_count) {
+  Record(DrawElementsCommand{mode, index_type, first, count, base_vertex, instance_count});
+}
+
+void CommandBuffer::MultiDrawElements(GLenum mode, GLenum index_type, const IndexRange *ranges,
+                                      size_t range_count) {
+  if (range_count == 0) {
+    return;
+  }
+  size_t size = kMultiDrawHeaderSize + range_count * (sizeof(void *) + sizeof(GLsizei));
+  auto *payload = static_cast<unsigned char *>(Append(&executeMultiDrawElements, size));
+  MultiDrawElementsHeader header = {mode, index_type, (uint32_t)range_count};
+  std::memcpy(payload, &header, sizeof(header));
+  unsigned char *offsets = payload + kMultiDrawHeaderSize;
+  unsigned char *counts = offsets + range_count * sizeof(void *);
+  for (size_t i = 0; i < range_count; i++) {
+    const void *offset = (const void *)(ranges[i].first * IndexSize(index_type));
+    auto count = (GLsizei)ranges[i].count;
+    std::memcpy(offsets + i * sizeof(void *), &offset, sizeof(offset));
+    std::memcpy(counts + i * sizeof(GLsizei), &count, sizeof(count));
+  }
+}
+
+ParallelRecorder::ParallelRecorder(unsigned int threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  buffers_.resize(threads);
+  for (size_t slice = 1; slice < threads; slice++) {
+    workers_.emplace_back(&ParallelRecorder::Work, this, slice);
+  }
+}
+
+ParallelRecorder::~ParallelRecorder() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  started_.notify_all();
+  for (std::thread &worker : workers_) {
+    worker.join();
+  }
+}
+
+void ParallelRecorder::Record(size_t count, const RecordFunction &record) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    record_ = &record;
+    count_ = count;
+    pending_ = workers_.size();
+    generation_++;
+  }
+  started_.notify_all();
+  // The calling thread takes the first slice rather than waiting idle.
+  RecordSlice(0);
+  std::unique_lock<std::mutex> lock(mutex_);
+  finished_.wait(lock, [this]() { return pending_ == 0; });
+  record_ = nullptr;
+}
+
+void ParallelRecorder::Execute() const {
+  for (const CommandBuffer &buffer : buffers_) {
+    buffer.Execute();
+  }
+}
+
+void ParallelRecorder::RecordSlice(size_t slice) {
+  // record_ and count_ are only written while no slice is being recorded.
+  CommandBuffer &buffer = buffers_[slice];
+  buffer.Reset();
+  size_t first = count_ * slice / buffers_.size();
+  size_t last = count_ * (slice + 1) / buffers_.size();
+  if (first < last) {
+    (*record_)(buffer, first, last);
+  }
+}
+
+void ParallelRecorder::Work(size_t slice) {
+  uint64_t generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      started_.wait(lock, [&]() { return stopping_ || generation_ != generation; });
+      if (stopping_) {
+        return;
+      }
+      generation = generation_;
+    }
+    RecordSlice(slice);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_--;
+    }
+    finished_.notify_one();
+  }
+}
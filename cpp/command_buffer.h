@@ -0,0 +1,148 @@
+#ifndef LEARNOPENGL_COMMAND_BUFFER_H
+#define LEARNOPENGL_COMMAND_BUFFER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <glm/glm.hpp>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "mesh.h"
+#include "opengl.h"
+
+/**
+ * GL calls recorded into a linear buffer, to be executed later on the GL thread. Recording makes
+ * no GL calls, so any thread can fill a buffer of its own while the GL thread is busy; only
+ * Execute needs the context.
+ *
+ * Each command is a replay function followed by its arguments, packed back to back, so recording
+ * is a bounds check and a copy and the buffer's memory is reused from frame to frame. Redundant
+ * program and vertex array binds within a buffer are dropped while recording.
+ *
+ * Buffers are cache line aligned, so that threads recording into neighbouring buffers, such as
+ * ParallelRecorder's, do not share the lines holding each other's sizes and binding state.
+ */
+class alignas(64) CommandBuffer {
+public:
+  /** Forgets the recorded commands, keeping the memory. */
+  void Reset();
+  size_t Size() const { return command_count_; }
+  size_t Bytes() const { return size_; }
+
+  /** Replays the commands in the order they were recorded. */
+  void Execute() const;
+
+  /**
+   * Records any command: a trivially copyable struct whose const Execute() makes the GL calls.
+   * It is copied into the buffer, so it must not point to anything that may change before
+   * replay.
+   */
+  template <typename Command>
+  void Record(const Command &command) {
+    static_assert(std::is_trivially_copyable_v<Command>, "commands are copied as bytes");
+    static_assert(alignof(Command) <= kAlignment, "commands are aligned to 8 bytes");
+    void *payload = Append(&ExecuteCommand<Command>, sizeof(Command));
+    std::memcpy(payload, &command, sizeof(Command));
+  }
+
+  void UseProgram(unsigned int program);
+  void BindVertexArray(unsigned int vao);
+  void BindTexture(unsigned int unit, unsigned int texture, GLenum target = GL_TEXTURE_2D);
+  void BindBufferRange(GLenum target, unsigned int index, unsigned int buffer, size_t offset,
+                       size_t size);
+  void SetUniform(int location, int value);
+  void SetUniform(int location, float value);
+  void SetUniform(int location, const glm::mat4 &value);
+  /**
+   * Sources the instance model matrices of vao from offset bytes into buffer, as
+   * InstanceBuffer::Attach does, and leaves vao bound.
+   */
+  void AttachInstances(unsigned int vao, unsigned int buffer, size_t offset);
+
+  void DrawArrays(GLenum mode, uint32_t first, uint32_t count, uint32_t instance_count = 1);
+  /** Draws count indices of index_type from index first, of the bound vertex array. */
+  void DrawElements(GLenum mode, GLenum index_type, uint32_t first, uint32_t count,
+                    int32_t base_vertex = 0, uint32_t instance_count = 1);
+  /** One glMultiDrawElements over the ranges, which are copied into the buffer. */
+  void MultiDrawElements(GLenum mode, GLenum index_type, const IndexRange *ranges,
+                         size_t range_count);
+
+private:
+  using ExecuteFunction = void (*)(const unsigned char *payload);
+  static constexpr size_t kAlignment = 8;
+  // Never a GL name, so nothing is dropped as redundant at the start of a buffer, including
+  // unbinding with zero.
+  static constexpr unsigned int kUnknown = ~0u;
+
+  struct Header {
+    ExecuteFunction execute;
+    // Bytes of arguments after the header, a multiple of kAlignment.
+    size_t size;
+  };
+
+  template <typename Command>
+  static void ExecuteCommand(const unsigned char *payload) {
+    reinterpret_cast<const Command *>(payload)->Execute();
+  }
+
+  // Reserves a command with size bytes of arguments and returns where they go.
+  void *Append(ExecuteFunction execute, size_t size);
+
+  // Grown but never shrunk, so size_ rather than bytes_.size() is the recorded length.
+  std::vector<unsigned char> bytes_;
+  size_t size_ = 0;
+  size_t command_count_ = 0;
+  // What the commands recorded so far leave bound, or kUnknown.
+  unsigned int program_ = kUnknown;
+  unsigned int vao_ = kUnknown;
+};
+
+/**
+ * Splits per-object work across a pool of threads that each record into their own CommandBuffer,
+ * then replays the buffers on the GL thread in a fixed order. Objects are handed out as
+ * contiguous slices, slice i to buffer i, so the replayed order is the order of the objects no
+ * matter which thread finishes first.
+ */
+class ParallelRecorder {
+public:
+  // Records the commands for objects [first, last) into buffer.
+  using RecordFunction = std::function<void(CommandBuffer &buffer, size_t first, size_t last)>;
+
+  // Zero threads means one per hardware thread. The calling thread is one of them.
+  explicit ParallelRecorder(unsigned int threads = 0);
+  ParallelRecorder(const ParallelRecorder &) = delete;
+  ParallelRecorder &operator=(const ParallelRecorder &) = delete;
+  ~ParallelRecorder();
+
+  size_t Threads() const { return buffers_.size(); }
+  const std::vector<CommandBuffer> &Buffers() const { return buffers_; }
+
+  /** Resets the buffers and records count objects into them, returning once all are done. */
+  void Record(size_t count, const RecordFunction &record);
+
+  /** Executes the buffers in order. GL thread only. */
+  void Execute() const;
+
+private:
+  void RecordSlice(size_t slice);
+  void Work(size_t slice);
+
+  std::vector<CommandBuffer> buffers_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable started_;
+  std::condition_variable finished_;
+  // Guarded by mutex_.
+  const RecordFunction *record_ = nullptr;
+  size_t count_ = 0;
+  uint64_t generation_ = 0;
+  size_t pending_ = 0;
+  bool stopping_ = false;
+};
+
+#endif // LEARNOPENGL_COMMAND_BUFFER_H
@@ -1,5 +1,8 @@
 #include "common.h"
 
+#include <atomic>
+#include <unistd.h>
+
 void checkShaderCompilationStatus(unsigned int shader, const std::string &name) {
   int success;
   char infoLog[512];
@@ -12,10 +15,31 @@ void checkShaderCompilationStatus(unsigned int shader, const std::string &name)
   }
 }
 
-unsigned int createShader(const char *source, GLenum shaderType, const std::string &name) {
+unsigned int compileShader(const char *source, GLenum shaderType) {
   unsigned int shader = glCreateShader(shaderType);
   glShaderSource(shader, 1, &source, nullptr);
   glCompileShader(shader);
+  return shader;
+}
+
+unsigned int createShader(const char *source, GLenum shaderType, const std::string &name) {
+  unsigned int shader = compileShader(source, shaderType);
   checkShaderCompilationStatus(shader, name);
   return shader;
-}
\ No newline at end of file
+}
+
+bool hasExtension(std::string_view name) {
+  int count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (int i = 0; i < count; i++) {
+    if (name == (const char *)glGetStringi(GL_EXTENSIONS, i)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string temporaryPathFor(const std::string &path) {
+  static std::atomic<uint32_t> next_temporary{0};
+  return path + "." + std::to_string(getpid()) + "." + std::to_string(next_temporary++) + ".tmp";
+}
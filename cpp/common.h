@@ -1,26 +1,95 @@
 #ifndef LEARNOPENGL_GLFW_COMMON_H
 #define LEARNOPENGL_GLFW_COMMON_H
 
+#include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 
 #include "opengl.h"
 
 void checkShaderCompilationStatus(unsigned int shader, const std::string &name);
 
+// Submits a shader for compilation without waiting for the result.
+unsigned int compileShader(const char *source, GLenum shaderType);
+
 unsigned int createShader(const char *source, GLenum shaderType, const std::string &name);
 
+// Whether the current context advertises the named extension.
+bool hasExtension(std::string_view name);
+
+// A name next to path, unique to this process and call, for writing a file that is then renamed
+// over path, so that concurrent writers never share or publish a partial file.
+std::string temporaryPathFor(const std::string &path);
+
 class GlfwApplication {
 public:
-  static std::unique_ptr<GlfwApplication> Create() {
-    glfwInit();
+  struct Options {
+    int width = 800;
+    int height = 600;
+    // Render into an offscreen framebuffer instead of a visible window. With GLFW 3.4 this uses the
+    // null platform, so no display server is needed; older versions fall back to a hidden window.
+    bool headless = false;
+    // Context creation API used when headless. EGL picks up a surfaceless Mesa driver (e.g.
+    // llvmpipe) on GPU-less machines; GLFW_OSMESA_CONTEXT_API is the alternative.
+    int headless_context_api = GLFW_EGL_CONTEXT_API;
+    // If positive, Run returns after this many frames. Headless runs have no window to close, so
+    // they stop after kDefaultHeadlessFrames unless told otherwise.
+    int max_frames = 0;
+    // Report the mean frame time when Run returns, and let demos print statistics of their own.
+    // Always on when headless, where that is the point of running.
+    bool stats = false;
+  };
+
+  static constexpr int kDefaultHeadlessFrames = 100;
+
+  /** Recognizes --headless, --osmesa, --frames=N and --stats; other arguments are ignored. */
+  static Options ParseOptions(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+      std::string_view arg(argv[i]);
+      if (arg == "--headless") {
+        options.headless = true;
+      } else if (arg == "--osmesa") {
+        options.headless = true;
+        options.headless_context_api = GLFW_OSMESA_CONTEXT_API;
+      } else if (arg.substr(0, 9) == "--frames=") {
+        options.max_frames = std::atoi(argv[i] + 9);
+      } else if (arg == "--stats") {
+        options.stats = true;
+      }
+    }
+    return options;
+  }
+
+  static std::unique_ptr<GlfwApplication> Create() { return Create(Options()); }
+
+  static std::unique_ptr<GlfwApplication> Create(const Options &options) {
+#ifdef GLFW_PLATFORM_NULL
+    if (options.headless) {
+      glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+#endif
+    if (!glfwInit()) {
+      std::cerr << "Failed to initialize GLFW" << std::endl;
+      return nullptr;
+    }
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
     // glfwWindowHint(GLFW_COCOA_MENUBAR, GL_FALSE);
+    if (options.headless) {
+      glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+      glfwWindowHint(GLFW_CONTEXT_CREATION_API, options.headless_context_api);
+    }
 
-    GLFWwindow *window = glfwCreateWindow(800, 600, "LearnOpenGL", NULL, NULL);
+    GLFWwindow *window =
+        glfwCreateWindow(options.width, options.height, "LearnOpenGL", NULL, NULL);
     if (window == NULL) {
       std::cerr << "Failed to Create GLFW window" << std::endl;
       glfwTerminate();
@@ -37,19 +106,51 @@ public:
     glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &nAttributes);
     std::cout << "Maximum vertex attributes supported: " << nAttributes << std::endl;
 
-    return std::unique_ptr<GlfwApplication>(new GlfwApplication(window));
+    int max_frames = options.max_frames;
+    if (options.headless && max_frames <= 0) {
+      max_frames = kDefaultHeadlessFrames;
+    }
+    auto app = std::unique_ptr<GlfwApplication>(
+        new GlfwApplication(window, max_frames, options.stats || options.headless));
+    if (options.headless && !app->CreateOffscreenFramebuffer(options.width, options.height)) {
+      std::cerr << "Failed to create offscreen framebuffer" << std::endl;
+      return nullptr;
+    }
+    return app;
   }
 
-  ~GlfwApplication() { glfwTerminate(); }
+  ~GlfwApplication() {
+    if (offscreen_framebuffer_ != 0) {
+      glDeleteFramebuffers(1, &offscreen_framebuffer_);
+      glDeleteRenderbuffers(2, offscreen_renderbuffers_);
+    }
+    glfwTerminate();
+  }
 
   void Run(const std::function<void()> &draw) {
+    int frames = 0;
+    double start = glfwGetTime();
     while (!glfwWindowShouldClose(window_)) {
       processInput(window_);
 
       draw();
 
-      glfwSwapBuffers(window_);
+      if (offscreen_framebuffer_ != 0) {
+        // Nothing is presented, so wait for the GPU here to keep frame times honest.
+        glFinish();
+      } else {
+        glfwSwapBuffers(window_);
+      }
       glfwPollEvents();
+
+      if (max_frames_ > 0 && ++frames == max_frames_) {
+        break;
+      }
+    }
+    if (stats_ && frames > 0) {
+      double elapsed_s = glfwGetTime() - start;
+      std::cout << "Rendered " << frames << " frames in " << elapsed_s << " s ("
+                << 1000.0 * elapsed_s / frames << " ms/frame)" << std::endl;
     }
   }
 
@@ -71,13 +172,40 @@ public:
     });
   }
 
+  /** Whether statistics were asked for, see Options::stats. */
+  bool Stats() const { return stats_; }
+
   void DisableCursor() { glfwSetInputMode(window_, GLFW_CURSOR, GLFW_CURSOR_DISABLED); }
 
 private:
-  explicit GlfwApplication(GLFWwindow *window) : window_(window) {
+  GlfwApplication(GLFWwindow *window, int max_frames, bool stats)
+      : window_(window), max_frames_(max_frames), stats_(stats) {
     glfwSetWindowUserPointer(window_, this);
   }
 
+  /**
+   * Headless contexts may have no default framebuffer at all (EGL surfaceless), so render into a
+   * framebuffer object of our own and leave it bound for the lifetime of the application.
+   */
+  bool CreateOffscreenFramebuffer(int width, int height) {
+    glGenFramebuffers(1, &offscreen_framebuffer_);
+    glGenRenderbuffers(2, offscreen_renderbuffers_);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreen_renderbuffers_[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreen_renderbuffers_[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, offscreen_framebuffer_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                              offscreen_renderbuffers_[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER,
+                              offscreen_renderbuffers_[1]);
+    glViewport(0, 0, width, height);
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+  }
+
   static void FramebufferSizeCallback([[maybe_unused]] GLFWwindow *window, int width, int height) {
     glViewport(0, 0, width, height);
   }
@@ -94,6 +222,10 @@ private:
   }
 
   GLFWwindow *window_;
+  int max_frames_;
+  bool stats_;
+  unsigned int offscreen_framebuffer_ = 0;
+  unsigned int offscreen_renderbuffers_[2] = {0, 0}; // Color, depth/stencil.
   std::unordered_map<int, std::function<void()>> key_callbacks_;
   std::optional<std::function<void(double, double)>> mouse_callback_;
   std::optional<std::function<void(double, double)>> scroll_callback_;
@@ -0,0 +1,40 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "mesh_file.h"
+#include "mesh_loader.h"
+
+// Converts an OBJ file into a cooked mesh file that MeshFile can map and upload directly.
+//
+//   cook_mesh [--no-optimize] <input.obj> <output.mesh>
+int main(int argc, char **argv) {
+  bool optimize = true;
+  const char *paths[2];
+  int n_paths = 0;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--no-optimize") == 0) {
+      optimize = false;
+    } else if (n_paths < 2) {
+      paths[n_paths++] = argv[i];
+    } else {
+      n_paths = 3;
+    }
+  }
+  if (n_paths != 2) {
+    std::cerr << "usage: " << argv[0] << " [--no-optimize] <input.obj> <output.mesh>" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::optional<IndexedMesh<MeshVertex>> mesh = LoadObj(paths[0]);
+  if (!mesh) {
+    return EXIT_FAILURE;
+  }
+  if (optimize) {
+    VertexCacheStatistics statistics = OptimizeMesh(*mesh);
+    std::cout << mesh->vertices.size() << " vertices, " << mesh->indices.size() / 3
+              << " triangles, ACMR " << statistics.acmr << ", ATVR " << statistics.atvr
+              << std::endl;
+  }
+  return WriteMeshFile(paths[1], *mesh) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
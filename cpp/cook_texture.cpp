@@ -0,0 +1,33 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "texture_file.h"
+
+// Converts a source image into a cooked texture file that LoadTextureFile can upload directly.
+//
+//   cook_texture [--flip] [--no-mipmaps] [--compress] <input image> <output.tex>
+int main(int argc, char **argv) {
+  CookTextureOptions options;
+  const char *paths[2];
+  int n_paths = 0;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--flip") == 0) {
+      options.flip_vertically = true;
+    } else if (std::strcmp(argv[i], "--no-mipmaps") == 0) {
+      options.generate_mipmaps = false;
+    } else if (std::strcmp(argv[i], "--compress") == 0) {
+      options.compress = true;
+    } else if (n_paths < 2) {
+      paths[n_paths++] = argv[i];
+    } else {
+      n_paths = 3;
+    }
+  }
+  if (n_paths != 2) {
+    std::cerr << "usage: " << argv[0]
+              << " [--flip] [--no-mipmaps] [--compress] <input image> <output.tex>" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return CookTexture(paths[0], paths[1], options) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,117 @@
+#include "draw_list.h"
+
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "common.h"
+#include "instance_buffer.h"
+
+namespace {
+
+// glad only loads these for GL 4.2 and 4.3 contexts, so on 3.3 they come from the extensions.
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC multiDrawElementsIndirect() {
+  static const PFNGLMULTIDRAWELEMENTSINDIRECTPROC function =
+      []() -> PFNGLMULTIDRAWELEMENTSINDIRECTPROC {
+    if (glMultiDrawElementsIndirect != nullptr) {
+      return glMultiDrawElementsIndirect;
+    }
+    // Multi-draw indirect on its own ignores base_instance, which the per-object data needs.
+    if (!hasExtension("GL_ARB_draw_indirect") || !hasExtension("GL_ARB_multi_draw_indirect") ||
+        !hasExtension("GL_ARB_base_instance")) {
+      return nullptr;
+    }
+    return (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)glfwGetProcAddress("glMultiDrawElementsIndirect");
+  }();
+  return function;
+}
+
+PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC drawElementsInstancedBaseVertexBaseInstance() {
+  static const PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC function =
+      []() -> PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC {
+    if (glDrawElementsInstancedBaseVertexBaseInstance != nullptr) {
+      return glDrawElementsInstancedBaseVertexBaseInstance;
+    }
+    if (!hasExtension("GL_ARB_base_instance")) {
+      return nullptr;
+    }
+    return (PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC)glfwGetProcAddress(
+        "glDrawElementsInstancedBaseVertexBaseInstance");
+  }();
+  return function;
+}
+
+} // namespace
+
+DrawList::DrawList(unsigned int vao, GLenum index_type)
+    : vao_(vao), index_type_(index_type), index_size_(IndexSize(index_type)) {
+  if (Indirect()) {
+    glGenBuffers(1, &indirect_buffer_);
+  }
+}
+
+DrawList::~DrawList() {
+  if (indirect_buffer_ != 0) {
+    glDeleteBuffers(1, &indirect_buffer_);
+  }
+}
+
+bool DrawList::Indirect() { return multiDrawElementsIndirect() != nullptr; }
+
+void DrawList::SetInstances(unsigned int buffer, size_t offset) {
+  instance_buffer_ = buffer;
+  instance_offset_ = offset;
+  InstanceBuffer::Attach(vao_, buffer, offset);
+}
+
+void DrawList::Upload() {
+  if (indirect_buffer_ == 0) {
+    return;
+  }
+  size_t size = commands_.size() * sizeof(Command);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer_);
+  // Respecifying the storage orphans the commands the GPU may still be reading.
+  indirect_capacity_ = std::max(indirect_capacity_, size);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER, indirect_capacity_, nullptr, GL_STREAM_DRAW);
+  glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, size, commands_.data());
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void DrawList::Submit(GLenum mode, size_t first, size_t count) const {
+  if (count == 0) {
+    return;
+  }
+  if (PFNGLMULTIDRAWELEMENTSINDIRECTPROC multi_draw = multiDrawElementsIndirect()) {
+    glBindVertexArray(vao_);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer_);
+    multi_draw(mode, index_type_, (void *)(first * sizeof(Command)), (GLsizei)count, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    return;
+  }
+
+  PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC draw_base_instance =
+      drawElementsInstancedBaseVertexBaseInstance();
+  glBindVertexArray(vao_);
+  for (size_t i = first; i < first + count; i++) {
+    const Command &command = commands_[i];
+    void *indices = (void *)(command.first_index * index_size_);
+    if (draw_base_instance != nullptr) {
+      draw_base_instance(mode, (GLsizei)command.count, index_type_, indices,
+                         (GLsizei)command.instance_count, command.base_vertex,
+                         command.base_instance);
+      continue;
+    }
+    if (instance_buffer_ != 0) {
+      InstanceBuffer::Attach(vao_, instance_buffer_,
+                             instance_offset_ + command.base_instance * sizeof(glm::mat4));
+      // Attach leaves no vertex array bound.
+      glBindVertexArray(vao_);
+    }
+    glDrawElementsInstancedBaseVertex(mode, (GLsizei)command.count, index_type_, indices,
+                                      (GLsizei)command.instance_count, command.base_vertex);
+  }
+  // Leave the instance attributes where SetInstances put them.
+  if (draw_base_instance == nullptr && instance_buffer_ != 0) {
+    InstanceBuffer::Attach(vao_, instance_buffer_, instance_offset_);
+    glBindVertexArray(vao_);
+  }
+}
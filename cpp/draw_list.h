@@ -0,0 +1,86 @@
+#ifndef LEARNOPENGL_DRAW_LIST_H
+#define LEARNOPENGL_DRAW_LIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "mesh_pool.h"
+#include "opengl.h"
+
+/**
+ * Indexed draws of meshes from one vertex array, such as a MeshPool's, recorded on the CPU and
+ * submitted together. With ARB_multi_draw_indirect and ARB_base_instance (core in GL 4.3) the
+ * commands go into a GL_DRAW_INDIRECT_BUFFER and a whole list costs one glMultiDrawElementsIndirect
+ * call. On plain GL 3.3, Submit loops over the commands instead.
+ *
+ * Each command's instances read their per-instance attributes, such as InstanceBuffer's model
+ * matrices, starting at its base instance, so every object gets its own data without changing the
+ * shader. Where base instance is not supported, the fallback re-attaches the instance attributes
+ * at each command's base instance, which is what makes it the slow path.
+ *
+ * Usage per frame: Clear, Add each draw, Upload, then Submit all or part of the list.
+ */
+class DrawList {
+public:
+  // The record glMultiDrawElementsIndirect reads, field for field.
+  struct Command {
+    uint32_t count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t base_vertex;
+    uint32_t base_instance;
+  };
+
+  /** index_type is the vertex array's GL_UNSIGNED_SHORT or GL_UNSIGNED_INT element buffer. */
+  DrawList(unsigned int vao, GLenum index_type);
+  template <typename Vertex, typename Index>
+  explicit DrawList(const MeshPool<Vertex, Index> &pool) : DrawList(pool.Vao(), pool.IndexType()) {}
+  DrawList(const DrawList &) = delete;
+  DrawList &operator=(const DrawList &) = delete;
+  ~DrawList();
+
+  /** Whether Submit issues one multi-draw rather than a loop of draws. */
+  static bool Indirect();
+
+  /**
+   * Sources the per-instance model matrices from buffer, with instance zero at offset bytes, as
+   * InstanceBuffer::Attach does. Without it, commands draw with whatever the vertex array has.
+   */
+  void SetInstances(unsigned int buffer, size_t offset = 0);
+
+  void Clear() { commands_.clear(); }
+  void Add(const Command &command) { commands_.push_back(command); }
+  /** Draws a pooled mesh with instance_count instances, reading them from base_instance on. */
+  void Add(const PooledMesh &mesh, uint32_t base_instance, uint32_t instance_count = 1) {
+    Add({mesh.index_count, instance_count, mesh.FirstIndex(), mesh.BaseVertex(), base_instance});
+  }
+  /** Draws count of the mesh's indices starting at its index first, such as one LOD level. */
+  void Add(const PooledMesh &mesh, uint32_t first, uint32_t count, uint32_t base_instance,
+           uint32_t instance_count) {
+    Add({count, instance_count, mesh.FirstIndex() + first, mesh.BaseVertex(), base_instance});
+  }
+
+  unsigned int Vao() const { return vao_; }
+  size_t Size() const { return commands_.size(); }
+  const std::vector<Command> &Commands() const { return commands_; }
+
+  /** Copies the commands to the GPU, orphaning last frame's. A no-op on the fallback path. */
+  void Upload();
+
+  /** Draws commands [first, first + count), as of the last Upload, e.g. one material's. */
+  void Submit(GLenum mode, size_t first, size_t count) const;
+  void Submit(GLenum mode = GL_TRIANGLES) const { Submit(mode, 0, commands_.size()); }
+
+private:
+  unsigned int vao_;
+  GLenum index_type_;
+  size_t index_size_;
+  unsigned int indirect_buffer_ = 0;
+  size_t indirect_capacity_ = 0;
+  unsigned int instance_buffer_ = 0;
+  size_t instance_offset_ = 0;
+  std::vector<Command> commands_;
+};
+
+#endif // LEARNOPENGL_DRAW_LIST_H
@@ -0,0 +1,61 @@
+#ifndef LEARNOPENGL_FRUSTUM_H
+#define LEARNOPENGL_FRUSTUM_H
+
+#include <array>
+#include <glm/glm.hpp>
+
+/**
+ * The six planes bounding what a projection matrix can see, extracted as described by Gribb and
+ * Hartmann. Each plane is (normal, distance) with the normal pointing inwards and unit length, so
+ * dot(normal, p) + distance is the signed distance of p from it.
+ */
+class Frustum {
+public:
+  enum PlaneIndex { LEFT, RIGHT, BOTTOM, TOP, NEAR, FAR };
+
+  /** matrix maps whatever space the planes should be in to clip space, e.g. projection * view. */
+  explicit Frustum(const glm::mat4 &matrix) {
+    // glm matrices are column-major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i]).
+    auto row = [&](int i) {
+      return glm::vec4(matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]);
+    };
+    glm::vec4 w = row(3);
+    for (int axis = 0; axis < 3; axis++) {
+      planes_[axis * 2] = w + row(axis);
+      planes_[axis * 2 + 1] = w - row(axis);
+    }
+    for (glm::vec4 &plane : planes_) {
+      plane = plane / glm::length(glm::vec3(plane.x, plane.y, plane.z));
+    }
+  }
+
+  const glm::vec4 &Plane(int index) const { return planes_[index]; }
+
+  /** Whether any part of the sphere may be inside. Spheres near corners can pass falsely. */
+  bool IntersectsSphere(const glm::vec3 &center, float radius) const {
+    for (const glm::vec4 &plane : planes_) {
+      if (glm::dot(glm::vec3(plane.x, plane.y, plane.z), center) + plane.w < -radius) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /** Whether any part of the box with this center and half-extent may be inside. */
+  bool IntersectsBox(const glm::vec3 &center, const glm::vec3 &extent) const {
+    for (const glm::vec4 &plane : planes_) {
+      glm::vec3 normal(plane.x, plane.y, plane.z);
+      // The box's extent along the normal, i.e. the distance of its most inward corner.
+      float reach = glm::dot(glm::abs(normal), extent);
+      if (glm::dot(normal, center) + plane.w < -reach) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  std::array<glm::vec4, 6> planes_;
+};
+
+#endif // LEARNOPENGL_FRUSTUM_H
@@ -0,0 +1,413 @@
+#include "frustum_culling.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// AVX2 kernels are built whatever the compiler targets and only run on CPUs that have it.
+#if defined(__SSE2__) && defined(__GNUC__)
+#define CULL_AVX2 1
+#endif
+
+namespace {
+
+// Fewer objects than this per thread are not worth handing one a slice.
+constexpr size_t kObjectsPerThread = 64 * 1024;
+// Slices start on whole AVX2 registers, which are whole SSE2 registers too.
+constexpr size_t kSliceAlignment = 8;
+
+#if defined(__SSE2__)
+// The SSE2 kernels are written against these few operations on a register of 4 lanes.
+constexpr size_t kLanes = 4;
+using Lanes = __m128;
+Lanes load(const float *p) { return _mm_loadu_ps(p); }
+Lanes splat(float value) { return _mm_set1_ps(value); }
+Lanes add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+Lanes mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+Lanes negate(Lanes a) { return _mm_sub_ps(_mm_setzero_ps(), a); }
+Lanes both(Lanes a, Lanes b) { return _mm_and_ps(a, b); }
+Lanes atLeast(Lanes a, Lanes b) { return _mm_cmpge_ps(a, b); }
+Lanes allSet() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+uint32_t mask(Lanes a) { return (uint32_t)_mm_movemask_ps(a); }
+
+// Byte i of kMaskBytes[mask] is bit i of mask, turning a lane mask into a visible[] byte each.
+constexpr std::array<uint64_t, 256> makeMaskBytes() {
+  std::array<uint64_t, 256> bytes = {};
+  for (uint32_t mask = 0; mask < 256; mask++) {
+    for (uint32_t bit = 0; bit < 8; bit++) {
+      bytes[mask] |= (uint64_t)((mask >> bit) & 1) << (bit * 8);
+    }
+  }
+  return bytes;
+}
+constexpr std::array<uint64_t, 256> kMaskBytes = makeMaskBytes();
+
+// Writes one visible byte for each of lane_count lanes and returns how many are set.
+size_t storeMask(uint32_t lanes, size_t lane_count, uint8_t *visible) {
+  uint64_t bytes = kMaskBytes[lanes];
+  std::memcpy(visible, &bytes, lane_count);
+  return __builtin_popcount(lanes);
+}
+
+// Each plane's components, splatted across the lanes.
+struct PlaneLanes {
+  Lanes x[6], y[6], z[6], w[6];
+  // Component magnitudes, for projecting box extents onto the normal.
+  Lanes abs_x[6], abs_y[6], abs_z[6];
+
+  explicit PlaneLanes(const Frustum &frustum) {
+    for (int i = 0; i < 6; i++) {
+      const glm::vec4 &plane = frustum.Plane(i);
+      x[i] = splat(plane.x), y[i] = splat(plane.y), z[i] = splat(plane.z), w[i] = splat(plane.w);
+      abs_x[i] = splat(std::abs(plane.x));
+      abs_y[i] = splat(std::abs(plane.y));
+      abs_z[i] = splat(std::abs(plane.z));
+    }
+  }
+};
+
+// The kernels below test whole registers from *first on, stopping short of last, and leave
+// *first at what is left for narrower registers or the scalar loop.
+
+size_t cullSpheresSse2(const Frustum &frustum, const SphereBounds &spheres, size_t *first,
+                       size_t last, uint8_t *visible) {
+  size_t i = *first, count = 0;
+  PlaneLanes planes(frustum);
+  for (; i + kLanes <= last; i += kLanes) {
+    Lanes x = load(&spheres.x[i]), y = load(&spheres.y[i]), z = load(&spheres.z[i]);
+    Lanes reach = negate(load(&spheres.radius[i]));
+    Lanes inside = allSet();
+    for (int p = 0; p < 6; p++) {
+      Lanes distance = add(add(mul(planes.x[p], x), mul(planes.y[p], y)),
+                           add(mul(planes.z[p], z), planes.w[p]));
+      inside = both(inside, atLeast(distance, reach));
+    }
+    count += storeMask(mask(inside), kLanes, visible + i);
+  }
+  *first = i;
+  return count;
+}
+
+size_t cullBoxesSse2(const Frustum &frustum, const BoxBounds &boxes, size_t *first, size_t last,
+                     uint8_t *visible) {
+  size_t i = *first, count = 0;
+  PlaneLanes planes(frustum);
+  for (; i + kLanes <= last; i += kLanes) {
+    Lanes x = load(&boxes.center_x[i]), y = load(&boxes.center_y[i]);
+    Lanes z = load(&boxes.center_z[i]);
+    Lanes extent_x = load(&boxes.extent_x[i]), extent_y = load(&boxes.extent_y[i]);
+    Lanes extent_z = load(&boxes.extent_z[i]);
+    Lanes inside = allSet();
+    for (int p = 0; p < 6; p++) {
+      Lanes distance = add(add(mul(planes.x[p], x), mul(planes.y[p], y)),
+                           add(mul(planes.z[p], z), planes.w[p]));
+      Lanes reach = add(add(mul(planes.abs_x[p], extent_x), mul(planes.abs_y[p], extent_y)),
+                        mul(planes.abs_z[p], extent_z));
+      inside = both(inside, atLeast(distance, negate(reach)));
+    }
+    count += storeMask(mask(inside), kLanes, visible + i);
+  }
+  *first = i;
+  return count;
+}
+#endif
+
+#if defined(CULL_AVX2)
+// The same kernels 8 lanes wide. Every function touching a __m256 is compiled for AVX2, so they
+// inline into each other but are only called once hasAvx2() says the CPU can run them.
+#define AVX2_TARGET __attribute__((target("avx2")))
+constexpr size_t kWideLanes = 8;
+using WideLanes = __m256;
+AVX2_TARGET WideLanes loadWide(const float *p) { return _mm256_loadu_ps(p); }
+AVX2_TARGET WideLanes splatWide(float value) { return _mm256_set1_ps(value); }
+AVX2_TARGET WideLanes add(WideLanes a, WideLanes b) { return _mm256_add_ps(a, b); }
+AVX2_TARGET WideLanes mul(WideLanes a, WideLanes b) { return _mm256_mul_ps(a, b); }
+AVX2_TARGET WideLanes negate(WideLanes a) { return _mm256_sub_ps(_mm256_setzero_ps(), a); }
+AVX2_TARGET WideLanes both(WideLanes a, WideLanes b) { return _mm256_and_ps(a, b); }
+AVX2_TARGET WideLanes atLeast(WideLanes a, WideLanes b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+AVX2_TARGET WideLanes allSetWide() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+AVX2_TARGET uint32_t mask(WideLanes a) { return (uint32_t)_mm256_movemask_ps(a); }
+
+struct WidePlaneLanes {
+  WideLanes x[6], y[6], z[6], w[6];
+  WideLanes abs_x[6], abs_y[6], abs_z[6];
+
+  AVX2_TARGET explicit WidePlaneLanes(const Frustum &frustum) {
+    for (int i = 0; i < 6; i++) {
+      const glm::vec4 &plane = frustum.Plane(i);
+      x[i] = splatWide(plane.x), y[i] = splatWide(plane.y), z[i] = splatWide(plane.z);
+      w[i] = splatWide(plane.w);
+      abs_x[i] = splatWide(std::abs(plane.x));
+      abs_y[i] = splatWide(std::abs(plane.y));
+      abs_z[i] = splatWide(std::abs(plane.z));
+    }
+  }
+};
+
+AVX2_TARGET size_t cullSpheresAvx2(const Frustum &frustum, const SphereBounds &spheres,
+                                   size_t *first, size_t last, uint8_t *visible) {
+  size_t i = *first, count = 0;
+  WidePlaneLanes planes(frustum);
+  for (; i + kWideLanes <= last; i += kWideLanes) {
+    WideLanes x = loadWide(&spheres.x[i]), y = loadWide(&spheres.y[i]);
+    WideLanes z = loadWide(&spheres.z[i]);
+    WideLanes reach = negate(loadWide(&spheres.radius[i]));
+    WideLanes inside = allSetWide();
+    for (int p = 0; p < 6; p++) {
+      WideLanes distance = add(add(mul(planes.x[p], x), mul(planes.y[p], y)),
+                               add(mul(planes.z[p], z), planes.w[p]));
+      inside = both(inside, atLeast(distance, reach));
+    }
+    count += storeMask(mask(inside), kWideLanes, visible + i);
+  }
+  *first = i;
+  return count;
+}
+
+AVX2_TARGET size_t cullBoxesAvx2(const Frustum &frustum, const BoxBounds &boxes, size_t *first,
+                                 size_t last, uint8_t *visible) {
+  size_t i = *first, count = 0;
+  WidePlaneLanes planes(frustum);
+  for (; i + kWideLanes <= last; i += kWideLanes) {
+    WideLanes x = loadWide(&boxes.center_x[i]), y = loadWide(&boxes.center_y[i]);
+    WideLanes z = loadWide(&boxes.center_z[i]);
+    WideLanes extent_x = loadWide(&boxes.extent_x[i]), extent_y = loadWide(&boxes.extent_y[i]);
+    WideLanes extent_z = loadWide(&boxes.extent_z[i]);
+    WideLanes inside = allSetWide();
+    for (int p = 0; p < 6; p++) {
+      WideLanes distance = add(add(mul(planes.x[p], x), mul(planes.y[p], y)),
+                               add(mul(planes.z[p], z), planes.w[p]));
+      WideLanes reach =
+          add(add(mul(planes.abs_x[p], extent_x), mul(planes.abs_y[p], extent_y)),
+              mul(planes.abs_z[p], extent_z));
+      inside = both(inside, atLeast(distance, negate(reach)));
+    }
+    count += storeMask(mask(inside), kWideLanes, visible + i);
+  }
+  *first = i;
+  return count;
+}
+#undef AVX2_TARGET
+
+bool hasAvx2() {
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+#endif
+
+size_t cullSpheres(const Frustum &frustum, const SphereBounds &spheres, size_t first,
+                   size_t last, uint8_t *visible) {
+  size_t i = first, count = 0;
+#if defined(CULL_AVX2)
+  if (hasAvx2()) {
+    count += cullSpheresAvx2(frustum, spheres, &i, last, visible);
+  }
+#endif
+#if defined(__SSE2__)
+  count += cullSpheresSse2(frustum, spheres, &i, last, visible);
+#endif
+  for (; i < last; i++) {
+    glm::vec3 center(spheres.x[i], spheres.y[i], spheres.z[i]);
+    visible[i] = frustum.IntersectsSphere(center, spheres.radius[i]);
+    count += visible[i];
+  }
+  return count;
+}
+
+size_t cullBoxes(const Frustum &frustum, const BoxBounds &boxes, size_t first, size_t last,
+                 uint8_t *visible) {
+  size_t i = first, count = 0;
+#if defined(CULL_AVX2)
+  if (hasAvx2()) {
+    count += cullBoxesAvx2(frustum, boxes, &i, last, visible);
+  }
+#endif
+#if defined(__SSE2__)
+  count += cullBoxesSse2(frustum, boxes, &i, last, visible);
+#endif
+  for (; i < last; i++) {
+    glm::vec3 center(boxes.center_x[i], boxes.center_y[i], boxes.center_z[i]);
+    glm::vec3 extent(boxes.extent_x[i], boxes.extent_y[i], boxes.extent_z[i]);
+    visible[i] = frustum.IntersectsBox(center, extent);
+    count += visible[i];
+  }
+  return count;
+}
+
+// One thread per hardware thread but the caller's, started by the first cull large enough to
+// split and then kept waiting for the next, so a cull costs a wake-up rather than thread starts.
+class CullWorkers {
+public:
+  // Runs slice(i) for each i in [0, slices), slice 0 on the calling thread.
+  using SliceFunction = std::function<void(unsigned int slice)>;
+
+  static CullWorkers &Get() {
+    static CullWorkers workers(std::max(1u, std::thread::hardware_concurrency()));
+    return workers;
+  }
+
+  explicit CullWorkers(unsigned int threads) {
+    for (unsigned int slice = 1; slice < threads; slice++) {
+      workers_.emplace_back([this, slice]() { Work(slice); });
+    }
+  }
+
+  ~CullWorkers() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    started_.notify_all();
+    for (std::thread &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  /** The most slices Run takes, counting the caller's. */
+  unsigned int Threads() const { return (unsigned int)workers_.size() + 1; }
+
+  /** Held by whichever thread is running a cull on the workers. */
+  std::mutex &Turn() { return turn_; }
+
+  /** Runs slices across the workers and returns once all are done. Hold Turn() while calling. */
+  void Run(unsigned int slices, const SliceFunction &slice) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      slice_ = &slice;
+      slices_ = slices;
+      pending_ = slices - 1;
+      generation_++;
+    }
+    started_.notify_all();
+    slice(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_.wait(lock, [this]() { return pending_ == 0; });
+    slice_ = nullptr;
+  }
+
+private:
+  void Work(unsigned int index) {
+    uint64_t generation = 0;
+    while (true) {
+      const SliceFunction *slice = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        started_.wait(lock, [&]() { return stopping_ || generation_ != generation; });
+        if (stopping_) {
+          return;
+        }
+        generation = generation_;
+        if (index >= slices_) {
+          continue;
+        }
+        slice = slice_;
+      }
+      (*slice)(index);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_--;
+      }
+      finished_.notify_one();
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex turn_;
+  std::mutex mutex_;
+  std::condition_variable started_;
+  std::condition_variable finished_;
+  // Guarded by mutex_.
+  const SliceFunction *slice_ = nullptr;
+  unsigned int slices_ = 0;
+  uint64_t generation_ = 0;
+  unsigned int pending_ = 0;
+  bool stopping_ = false;
+};
+
+// Splits [0, count) into one slice per thread, on whole registers, and adds up what
+// cull(first, last) returns for each. If another thread is already culling on the workers, this
+// one culls everything itself rather than wait its turn.
+template <typename Cull>
+size_t cullInParallel(size_t count, unsigned int threads, Cull cull) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, (unsigned int)(count / kObjectsPerThread) + 1);
+  }
+  threads = std::min(threads, (unsigned int)(count / kSliceAlignment) + 1);
+  if (threads <= 1) {
+    return cull(0, count);
+  }
+  CullWorkers &workers = CullWorkers::Get();
+  threads = std::min(threads, workers.Threads());
+  std::unique_lock<std::mutex> turn(workers.Turn(), std::try_to_lock);
+  if (threads <= 1 || !turn.owns_lock()) {
+    return cull(0, count);
+  }
+  std::vector<size_t> visible(threads);
+  auto bound = [&](unsigned int t) {
+    return t == threads ? count : count * t / threads / kSliceAlignment * kSliceAlignment;
+  };
+  workers.Run(threads, [&](unsigned int t) { visible[t] = cull(bound(t), bound(t + 1)); });
+  size_t total = 0;
+  for (size_t slice : visible) {
+    total += slice;
+  }
+  return total;
+}
+
+} // namespace
+
+void SphereBounds::Clear() {
+  x.clear(), y.clear(), z.clear(), radius.clear();
+}
+
+void SphereBounds::Add(const glm::vec3 &center, float sphere_radius) {
+  x.push_back(center.x), y.push_back(center.y), z.push_back(center.z);
+  radius.push_back(sphere_radius);
+}
+
+void SphereBounds::Set(size_t index, const glm::vec3 &center, float sphere_radius) {
+  x[index] = center.x, y[index] = center.y, z[index] = center.z;
+  radius[index] = sphere_radius;
+}
+
+void BoxBounds::Clear() {
+  center_x.clear(), center_y.clear(), center_z.clear();
+  extent_x.clear(), extent_y.clear(), extent_z.clear();
+}
+
+void BoxBounds::Add(const glm::vec3 &min, const glm::vec3 &max) {
+  center_x.push_back(0.0f), center_y.push_back(0.0f), center_z.push_back(0.0f);
+  extent_x.push_back(0.0f), extent_y.push_back(0.0f), extent_z.push_back(0.0f);
+  Set(Size() - 1, min, max);
+}
+
+void BoxBounds::Set(size_t index, const glm::vec3 &min, const glm::vec3 &max) {
+  glm::vec3 center = (min + max) * 0.5f;
+  glm::vec3 extent = (max - min) * 0.5f;
+  center_x[index] = center.x, center_y[index] = center.y, center_z[index] = center.z;
+  extent_x[index] = extent.x, extent_y[index] = extent.y, extent_z[index] = extent.z;
+}
+
+size_t CullSpheres(const Frustum &frustum, const SphereBounds &spheres, uint8_t *visible,
+                   unsigned int threads) {
+  return cullInParallel(spheres.Size(), threads, [&](size_t first, size_t last) {
+    return cullSpheres(frustum, spheres, first, last, visible);
+  });
+}
+
+size_t CullBoxes(const Frustum &frustum, const BoxBounds &boxes, uint8_t *visible,
+                 unsigned int threads) {
+  return cullInParallel(boxes.Size(), threads, [&](size_t first, size_t last) {
+    return cullBoxes(frustum, boxes, first, last, visible);
+  });
+}
@@ -0,0 +1,48 @@
+#ifndef LEARNOPENGL_FRUSTUM_CULLING_H
+#define LEARNOPENGL_FRUSTUM_CULLING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "frustum.h"
+
+// Culling many objects at once against a Frustum. Bounds are stored structure-of-arrays, one array
+// per component, so a SIMD register loads the same component of consecutive objects and each
+// plane is tested against 8 objects per instruction on CPUs with AVX2, chosen at run time, and 4
+// with SSE2. Large sets are split across a pool of threads that waits for the next cull.
+
+/** Bounding spheres, one entry per object. */
+struct SphereBounds {
+  std::vector<float> x, y, z, radius;
+
+  size_t Size() const { return x.size(); }
+  void Clear();
+  void Add(const glm::vec3 &center, float radius);
+  void Set(size_t index, const glm::vec3 &center, float radius);
+};
+
+/** Axis-aligned bounding boxes, one entry per object, stored as center and half-extent. */
+struct BoxBounds {
+  std::vector<float> center_x, center_y, center_z;
+  std::vector<float> extent_x, extent_y, extent_z;
+
+  size_t Size() const { return center_x.size(); }
+  void Clear();
+  void Add(const glm::vec3 &min, const glm::vec3 &max);
+  void Set(size_t index, const glm::vec3 &min, const glm::vec3 &max);
+};
+
+/**
+ * Sets visible[i] to 1 if object i may be inside the frustum and 0 if it is not, and returns the
+ * number visible. Zero threads picks a count from the number of objects; either way there is at
+ * most one per hardware thread. Small sets are culled on the calling thread, as is everything
+ * while another thread's cull has the pool.
+ */
+size_t CullSpheres(const Frustum &frustum, const SphereBounds &spheres, uint8_t *visible,
+                   unsigned int threads = 0);
+size_t CullBoxes(const Frustum &frustum, const BoxBounds &boxes, uint8_t *visible,
+                 unsigned int threads = 0);
+
+#endif // LEARNOPENGL_FRUSTUM_CULLING_H
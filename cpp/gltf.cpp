@@ -0,0 +1,129 @@
+#include <cstdlib>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <string_view>
+
+#include "camera.h"
+#include "common.h"
+#include "gltf_model.h"
+#include "instance_buffer.h"
+#include "ring_buffer.h"
+#include "shader.h"
+#include "texture_loader.h"
+
+// The Frame uniform block of vertex_shader.glsl, in std140 layout.
+struct FrameUniforms {
+  glm::mat4 view;
+  glm::mat4 projection;
+};
+
+// Draws a binary glTF model, uploaded straight from a mapping of the file, turning in front of
+// the camera.
+//
+//   gltf [--headless] [--frames=N] [model.glb]
+int main(int argc, char **argv) {
+  const char *path = "/Users/kal/Code/learnopengl/model.glb";
+  for (int i = 1; i < argc; i++) {
+    if (std::string_view(argv[i]).substr(0, 2) != "--") {
+      path = argv[i];
+    }
+  }
+
+  auto app = GlfwApplication::Create(GlfwApplication::ParseOptions(argc, argv));
+
+  Shader shader("/Users/kal/Code/learnopengl/vertex_shader.glsl",
+                "/Users/kal/Code/learnopengl/fragment_shader.glsl", Shader::kAsync);
+  TextureLoader loader(/*threads=*/0, /*compress=*/true);
+  unsigned int texture1 = loader.Load("/Users/kal/Code/learnopengl/container.jpeg");
+  unsigned int texture2 =
+      loader.Load("/Users/kal/Code/learnopengl/awesomeface.png", /*flip_vertically=*/true);
+
+  std::unique_ptr<GltfModel> model = GltfModel::Load(path);
+  if (!model) {
+    return EXIT_FAILURE;
+  }
+  if (app->Stats()) {
+    std::cout << path << ": " << model->Primitives().size() << " primitives" << std::endl;
+  }
+  // Every primitive's vertex array reads the one model matrix from the same buffer.
+  InstanceBuffer instances(GL_STREAM_DRAW);
+  for (const GltfModel::Primitive &primitive : model->Primitives()) {
+    instances.Attach(primitive.vao);
+  }
+
+  glEnable(GL_DEPTH_TEST);
+
+  float delta_time = 0.0f;
+  float last_frame = 0.0f;
+  Camera camera(glm::vec3(0.0, 0.0, 3.0f));
+  app->OnKey(GLFW_KEY_W, [&]() { camera.ProcessKeyboard(FORWARD, delta_time); });
+  app->OnKey(GLFW_KEY_S, [&]() { camera.ProcessKeyboard(BACKWARD, delta_time); });
+  app->OnKey(GLFW_KEY_A, [&]() { camera.ProcessKeyboard(LEFT, delta_time); });
+  app->OnKey(GLFW_KEY_D, [&]() { camera.ProcessKeyboard(RIGHT, delta_time); });
+
+  app->DisableCursor();
+  float last_x = 400, last_y = 300;
+  bool first_mouse = true;
+  app->OnMouse([&](double x, double y) {
+    if (first_mouse) {
+      last_x = x;
+      last_y = y;
+      first_mouse = false;
+    }
+    camera.ProcessMouseMovement(x - last_x, y - last_y);
+    last_x = x;
+    last_y = y;
+  });
+  app->OnScroll([&]([[maybe_unused]] double x, double y) { camera.ProcessMouseScroll(y); });
+
+  Shader::Uniform texture1_uniform = shader.uniform("texture1");
+  Shader::Uniform texture2_uniform = shader.uniform("texture2");
+  shader.bindUniformBlock("Frame", 0);
+  shader.use();
+  shader.setInt(texture1_uniform, 0);
+  shader.setInt(texture2_uniform, 1);
+
+  RingBuffer ring(sizeof(FrameUniforms));
+  app->Run([&]() {
+    loader.Update();
+
+    float current_frame = glfwGetTime();
+    delta_time = current_frame - last_frame;
+    last_frame = current_frame;
+
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture1);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, texture2);
+
+    ring.BeginFrame();
+    RingBuffer::Allocation frame = ring.Allocate(sizeof(FrameUniforms), ring.UniformAlignment());
+    if (frame.data == nullptr) {
+      ring.EndFrame();
+      return;
+    }
+    FrameUniforms uniforms = {camera.ViewMatrix(), glm::perspective(glm::radians(camera.Zoom()),
+                                                                    800.0f / 600.0f, 0.1f, 100.0f)};
+    std::memcpy(frame.data, &uniforms, sizeof(uniforms));
+    glBindBufferRange(GL_UNIFORM_BUFFER, 0, ring.Buffer(), frame.offset, sizeof(uniforms));
+    ring.Flush();
+
+    glm::mat4 transform =
+        glm::rotate(glm::mat4(1.0f), current_frame * 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+    instances.Upload(&transform, 1);
+
+    shader.use();
+    model->Draw();
+    ring.EndFrame();
+
+    glBindVertexArray(0);
+  });
+
+  glDeleteTextures(1, &texture1);
+  glDeleteTextures(1, &texture2);
+}
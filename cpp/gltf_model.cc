@@ -0,0 +1,481 @@
+#include "gltf_model.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "mapped_file.h"
+#include "mesh_loader.h"
+
+namespace {
+
+constexpr uint32_t kGlbMagic = 0x46546C67; // "glTF"
+constexpr uint32_t kGlbVersion = 2;
+constexpr uint32_t kJsonChunk = 0x4E4F534A; // "JSON"
+constexpr uint32_t kBinChunk = 0x004E4942;  // "BIN\0"
+
+// Just enough JSON for glTF: numbers are doubles and string escapes other than the single-character
+// ones become '?', which is fine for the ASCII keys and enum strings that matter here.
+struct JsonValue {
+  enum Type { kNull, kBool, kNumber, kString, kArray, kObject };
+
+  Type type = kNull;
+  bool boolean = false;
+  double number = 0.0;
+  std::string string;
+  std::vector<JsonValue> array;
+  std::vector<std::pair<std::string, JsonValue>> object;
+
+  /** The member called key, or a null value. */
+  const JsonValue &operator[](std::string_view key) const {
+    for (const auto &[name, value] : object) {
+      if (name == key) {
+        return value;
+      }
+    }
+    return Null();
+  }
+
+  /** The array element at index, or a null value. */
+  const JsonValue &At(size_t index) const { return index < array.size() ? array[index] : Null(); }
+
+  static const JsonValue &Null() {
+    static const JsonValue null;
+    return null;
+  }
+
+  bool Has(std::string_view key) const { return (*this)[key].type != kNull; }
+
+  /** The value as a non-negative integer below 2^53, or fallback if it is not one. */
+  size_t Index(size_t fallback = 0) const {
+    return type == kNumber && number >= 0 && number < 9007199254740992.0 ? (size_t)number
+                                                                          : fallback;
+  }
+};
+
+class JsonParser {
+public:
+  JsonParser(const char *begin, const char *end) : p_(begin), end_(end) {}
+
+  bool Parse(JsonValue &value) { return parseValue(value, 0) && (skipSpace(), p_ == end_); }
+
+private:
+  static constexpr int kMaxDepth = 64;
+
+  void skipSpace() {
+    // The JSON chunk may be padded with spaces, and some exporters add a trailing NUL.
+    while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r' || *p_ == 0)) {
+      p_++;
+    }
+  }
+
+  bool consume(std::string_view literal) {
+    if ((size_t)(end_ - p_) < literal.size() || std::string_view(p_, literal.size()) != literal) {
+      return false;
+    }
+    p_ += literal.size();
+    return true;
+  }
+
+  bool parseString(std::string &string) {
+    if (!consume("\"")) {
+      return false;
+    }
+    while (p_ < end_ && *p_ != '"') {
+      char c = *p_++;
+      if (c == '\\' && p_ < end_) {
+        char escape = *p_++;
+        switch (escape) {
+        case 'b':
+          c = '\b';
+          break;
+        case 'f':
+          c = '\f';
+          break;
+        case 'n':
+          c = '\n';
+          break;
+        case 'r':
+          c = '\r';
+          break;
+        case 't':
+          c = '\t';
+          break;
+        case 'u':
+          p_ += std::min<ptrdiff_t>(4, end_ - p_);
+          c = '?';
+          break;
+        default:
+          c = escape;
+        }
+      }
+      string.push_back(c);
+    }
+    return consume("\"");
+  }
+
+  bool parseNumber(double &number) {
+    const char *start = p_;
+    while (p_ < end_ && std::string_view("+-.eE0123456789").find(*p_) != std::string_view::npos) {
+      p_++;
+    }
+    if (p_ == start) {
+      return false;
+    }
+    // strtod needs a terminated string; numbers are short.
+    std::string text(start, p_);
+    char *parsed_end;
+    number = std::strtod(text.c_str(), &parsed_end);
+    return parsed_end == text.c_str() + text.size();
+  }
+
+  bool parseValue(JsonValue &value, int depth) {
+    skipSpace();
+    if (p_ == end_ || depth > kMaxDepth) {
+      return false;
+    }
+    switch (*p_) {
+    case '{':
+      value.type = JsonValue::kObject;
+      p_++;
+      skipSpace();
+      if (consume("}")) {
+        return true;
+      }
+      do {
+        skipSpace();
+        value.object.emplace_back();
+        if (!parseString(value.object.back().first) || (skipSpace(), !consume(":")) ||
+            !parseValue(value.object.back().second, depth + 1)) {
+          return false;
+        }
+        skipSpace();
+      } while (consume(","));
+      return consume("}");
+    case '[':
+      value.type = JsonValue::kArray;
+      p_++;
+      skipSpace();
+      if (consume("]")) {
+        return true;
+      }
+      do {
+        value.array.emplace_back();
+        if (!parseValue(value.array.back(), depth + 1)) {
+          return false;
+        }
+        skipSpace();
+      } while (consume(","));
+      return consume("]");
+    case '"':
+      value.type = JsonValue::kString;
+      return parseString(value.string);
+    case 't':
+      value.type = JsonValue::kBool;
+      value.boolean = true;
+      return consume("true");
+    case 'f':
+      value.type = JsonValue::kBool;
+      return consume("false");
+    case 'n':
+      return consume("null");
+    default:
+      value.type = JsonValue::kNumber;
+      return parseNumber(value.number);
+    }
+  }
+
+  const char *p_;
+  const char *end_;
+};
+
+struct BufferView {
+  size_t offset;
+  size_t length;
+  size_t stride;
+};
+
+struct Accessor {
+  size_t view;
+  size_t offset;
+  GLenum component_type;
+  int size;
+  bool normalized;
+  size_t count;
+  // In bytes, never zero.
+  size_t stride;
+};
+
+struct AttributeBinding {
+  unsigned int location;
+  Accessor accessor;
+};
+
+struct PrimitiveDescription {
+  GLenum mode;
+  std::vector<AttributeBinding> attributes;
+  std::optional<Accessor> indices;
+  size_t vertex_count;
+};
+
+struct GlbContents {
+  std::vector<BufferView> views;
+  std::vector<PrimitiveDescription> primitives;
+  const unsigned char *binary = nullptr;
+  size_t binary_size = 0;
+};
+
+size_t componentSize(GLenum type) {
+  switch (type) {
+  case GL_BYTE:
+  case GL_UNSIGNED_BYTE:
+    return 1;
+  case GL_SHORT:
+  case GL_UNSIGNED_SHORT:
+    return 2;
+  case GL_UNSIGNED_INT:
+  case GL_FLOAT:
+    return 4;
+  default:
+    return 0;
+  }
+}
+
+int componentCount(const std::string &type) {
+  if (type == "SCALAR") {
+    return 1;
+  }
+  if (type.size() == 4 && type.compare(0, 3, "VEC") == 0 && type[3] >= '2' && type[3] <= '4') {
+    return type[3] - '0';
+  }
+  return 0;
+}
+
+bool readAccessor(const JsonValue &json, size_t index, const std::vector<BufferView> &views,
+                  Accessor &accessor) {
+  const JsonValue &description = json["accessors"].At(index);
+  if (!description.Has("bufferView") || description.Has("sparse")) {
+    return false;
+  }
+  accessor.view = description["bufferView"].Index(views.size());
+  accessor.offset = description["byteOffset"].Index();
+  accessor.component_type = (GLenum)description["componentType"].Index();
+  accessor.size = componentCount(description["type"].string);
+  accessor.normalized = description["normalized"].boolean;
+  accessor.count = description["count"].Index();
+  if (accessor.view >= views.size() || accessor.size == 0 || accessor.count == 0) {
+    return false;
+  }
+  size_t component_size = componentSize(accessor.component_type);
+  size_t element_size = component_size * accessor.size;
+  if (element_size == 0 || accessor.offset % component_size != 0) {
+    return false;
+  }
+  // glTF allows strides of 4 to 252 bytes in steps of 4, and one smaller than an element would
+  // overlap them.
+  const BufferView &view = views[accessor.view];
+  if (view.stride != 0 &&
+      (view.stride < element_size || view.stride > 252 || view.stride % 4 != 0)) {
+    return false;
+  }
+  accessor.stride = view.stride != 0 ? view.stride : element_size;
+  // Arranged so that nothing overflows, however large the counts in the JSON.
+  return accessor.offset <= view.length && element_size <= view.length - accessor.offset &&
+         accessor.count - 1 <= (view.length - accessor.offset - element_size) / accessor.stride;
+}
+
+// The largest value of an index accessor already checked to lie within its view.
+uint32_t maxIndex(const GlbContents &contents, const Accessor &indices) {
+  const unsigned char *data = contents.binary + contents.views[indices.view].offset +
+                              indices.offset;
+  uint32_t largest = 0;
+  for (size_t i = 0; i < indices.count; i++) {
+    uint32_t index = 0;
+    if (indices.component_type == GL_UNSIGNED_BYTE) {
+      index = data[i];
+    } else if (indices.component_type == GL_UNSIGNED_SHORT) {
+      uint16_t value;
+      std::memcpy(&value, data + i * sizeof(value), sizeof(value));
+      index = value;
+    } else {
+      std::memcpy(&index, data + i * sizeof(index), sizeof(index));
+    }
+    largest = std::max(largest, index);
+  }
+  return largest;
+}
+
+bool parseGlb(const unsigned char *data, size_t size, JsonValue &json, GlbContents &contents) {
+  auto read32 = [&](size_t offset) {
+    uint32_t value;
+    std::memcpy(&value, data + offset, sizeof(value));
+    return value;
+  };
+  if (size < 20 || read32(0) != kGlbMagic || read32(4) != kGlbVersion || read32(8) > size) {
+    return false;
+  }
+  size = read32(8);
+
+  // The JSON chunk comes first; the binary chunk is optional.
+  size_t json_size = read32(12);
+  if (read32(16) != kJsonChunk || json_size > size - 20) {
+    return false;
+  }
+  const char *json_begin = reinterpret_cast<const char *>(data + 20);
+  if (!JsonParser(json_begin, json_begin + json_size).Parse(json)) {
+    return false;
+  }
+  size_t binary_offset = 20 + json_size;
+  if (binary_offset + 8 <= size && read32(binary_offset + 4) == kBinChunk) {
+    contents.binary = data + binary_offset + 8;
+    contents.binary_size = read32(binary_offset);
+    if (contents.binary_size > size - binary_offset - 8) {
+      return false;
+    }
+  }
+
+  for (const JsonValue &view : json["bufferViews"].array) {
+    BufferView buffer_view{view["byteOffset"].Index(), view["byteLength"].Index(),
+                           view["byteStride"].Index()};
+    // Only the embedded binary chunk (buffer 0 without a uri) is supported.
+    const JsonValue &buffer = json["buffers"].At(0);
+    if (view["buffer"].Index() != 0 || buffer.Has("uri") || contents.binary == nullptr ||
+        buffer_view.offset > contents.binary_size ||
+        buffer_view.length > contents.binary_size - buffer_view.offset) {
+      return false;
+    }
+    contents.views.push_back(buffer_view);
+  }
+
+  const std::pair<const char *, unsigned int> kAttributeLocations[] = {
+      {"POSITION", 0}, {"TEXCOORD_0", 1}, {"NORMAL", MeshVertex::kNormalLocation}};
+  for (const JsonValue &mesh : json["meshes"].array) {
+    for (const JsonValue &primitive : mesh["primitives"].array) {
+      PrimitiveDescription description;
+      description.mode = (GLenum)primitive["mode"].Index(GL_TRIANGLES);
+      description.vertex_count = 0;
+      for (const auto &[name, location] : kAttributeLocations) {
+        if (!primitive["attributes"].Has(name)) {
+          continue;
+        }
+        AttributeBinding binding{location, {}};
+        if (!readAccessor(json, primitive["attributes"][name].Index(), contents.views,
+                          binding.accessor)) {
+          return false;
+        }
+        if (location == 0) {
+          description.vertex_count = binding.accessor.count;
+        }
+        description.attributes.push_back(binding);
+      }
+      if (description.vertex_count == 0) {
+        return false;
+      }
+      // Every attribute must cover every vertex, or drawing reads past the shorter ones.
+      for (const AttributeBinding &binding : description.attributes) {
+        if (binding.accessor.count != description.vertex_count) {
+          return false;
+        }
+      }
+      if (primitive.Has("indices")) {
+        Accessor indices;
+        if (!readAccessor(json, primitive["indices"].Index(), contents.views, indices) ||
+            indices.size != 1 || contents.views[indices.view].stride != 0 ||
+            (indices.component_type != GL_UNSIGNED_BYTE &&
+             indices.component_type != GL_UNSIGNED_SHORT &&
+             indices.component_type != GL_UNSIGNED_INT)) {
+          return false;
+        }
+        if (maxIndex(contents, indices) >= description.vertex_count) {
+          return false;
+        }
+        description.indices = indices;
+      }
+      contents.primitives.push_back(std::move(description));
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+std::unique_ptr<GltfModel> GltfModel::Load(const std::string &path) {
+  std::unique_ptr<MappedFile> file = MappedFile::Open(path);
+  if (!file) {
+    std::cerr << "Error: failed to open " << path << std::endl;
+    return nullptr;
+  }
+  JsonValue json;
+  GlbContents contents;
+  if (!parseGlb(file->Data(), file->Size(), json, contents)) {
+    std::cerr << "Error: " << path << " is not a supported binary glTF file" << std::endl;
+    return nullptr;
+  }
+
+  std::unique_ptr<GltfModel> model(new GltfModel());
+
+  // Upload each buffer view that a primitive uses, once, directly from the mapping. Buffer objects
+  // are not typed, so a view uploaded through GL_ARRAY_BUFFER can also serve as an index buffer.
+  std::vector<unsigned int> view_buffers(contents.views.size(), 0);
+  auto buffer = [&](size_t view) {
+    if (view_buffers[view] == 0) {
+      glGenBuffers(1, &view_buffers[view]);
+      glBindBuffer(GL_ARRAY_BUFFER, view_buffers[view]);
+      glBufferData(GL_ARRAY_BUFFER, contents.views[view].length,
+                   contents.binary + contents.views[view].offset, GL_STATIC_DRAW);
+      model->buffers_.push_back(view_buffers[view]);
+    }
+    return view_buffers[view];
+  };
+
+  for (const PrimitiveDescription &description : contents.primitives) {
+    Primitive primitive;
+    primitive.mode = description.mode;
+    glGenVertexArrays(1, &primitive.vao);
+    glBindVertexArray(primitive.vao);
+    for (const AttributeBinding &attribute : description.attributes) {
+      const Accessor &accessor = attribute.accessor;
+      glBindBuffer(GL_ARRAY_BUFFER, buffer(accessor.view));
+      glVertexAttribPointer(attribute.location, accessor.size, accessor.component_type,
+                            accessor.normalized, (GLsizei)accessor.stride,
+                            (void *)accessor.offset);
+      glEnableVertexAttribArray(attribute.location);
+    }
+    if (description.indices) {
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer(description.indices->view));
+      primitive.count = (int)description.indices->count;
+      primitive.index_type = description.indices->component_type;
+      primitive.index_offset = description.indices->offset;
+    } else {
+      primitive.count = (int)description.vertex_count;
+    }
+    glBindVertexArray(0);
+    model->primitives_.push_back(primitive);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  return model;
+}
+
+GltfModel::~GltfModel() {
+  for (const Primitive &primitive : primitives_) {
+    glDeleteVertexArrays(1, &primitive.vao);
+  }
+  glDeleteBuffers((GLsizei)buffers_.size(), buffers_.data());
+}
+
+void GltfModel::DrawInstanced(int instance_count) const {
+  for (const Primitive &primitive : primitives_) {
+    glBindVertexArray(primitive.vao);
+    if (primitive.index_type != 0) {
+      glDrawElementsInstanced(primitive.mode, primitive.count, primitive.index_type,
+                              (void *)primitive.index_offset, instance_count);
+    } else {
+      glDrawArraysInstanced(primitive.mode, 0, primitive.count, instance_count);
+    }
+  }
+}
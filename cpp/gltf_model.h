@@ -0,0 +1,53 @@
+#ifndef LEARNOPENGL_GLTF_MODEL_H
+#define LEARNOPENGL_GLTF_MODEL_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "opengl.h"
+
+/**
+ * The mesh primitives of a binary glTF 2.0 file (.glb), uploaded straight from a memory mapping of
+ * the file. Each referenced buffer view becomes one GL buffer, and accessors become vertex
+ * attribute pointers and index offsets into those buffers, so geometry is never copied or
+ * converted on the CPU. glTF component types are GL enums, so any accessor format can be used
+ * as-is.
+ *
+ * POSITION, TEXCOORD_0 and NORMAL are bound to the locations of MeshVertex. Node transforms,
+ * materials, sparse accessors and buffers outside the .glb are not supported.
+ */
+class GltfModel {
+public:
+  struct Primitive {
+    unsigned int vao = 0;
+    GLenum mode = GL_TRIANGLES;
+    // Indices to draw, or vertices if the primitive is not indexed.
+    int count = 0;
+    // GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, or 0 if not indexed.
+    GLenum index_type = 0;
+    size_t index_offset = 0;
+  };
+
+  /** Returns nullptr if the file cannot be read or is not a .glb this class supports. */
+  static std::unique_ptr<GltfModel> Load(const std::string &path);
+
+  GltfModel(const GltfModel &) = delete;
+  GltfModel &operator=(const GltfModel &) = delete;
+  ~GltfModel();
+
+  const std::vector<Primitive> &Primitives() const { return primitives_; }
+
+  /** Draws every primitive. Leaves the last vertex array bound. */
+  void Draw() const { DrawInstanced(1); }
+  void DrawInstanced(int instance_count) const;
+
+private:
+  GltfModel() = default;
+
+  std::vector<unsigned int> buffers_;
+  std::vector<Primitive> primitives_;
+};
+
+#endif // LEARNOPENGL_GLTF_MODEL_H
@@ -1,19 +1,7 @@
-#include <iostream>
-
-// clang-format off
-#include <glad/glad.h>
-#include <GLFW/glfw3.h>
-// clang-format on
-
-void framebuffer_size_callback([[maybe_unused]] GLFWwindow *window, int width, int height) {
-  glViewport(0, 0, width, height);
-}
-
-void processInput(GLFWwindow *window) {
-  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-    glfwSetWindowShouldClose(window, true);
-  }
-}
+#include "common.h"
+#include "mesh.h"
+#include "render_queue.h"
+#include <iterator>
 
 // float vertices[] = {
 //     0.5f,  0.5f,  0.0f, // top right
@@ -22,18 +10,26 @@ void processInput(GLFWwindow *window) {
 //     -0.5f, 0.5f,  0.0f  // top left
 // };
 
-float vertices_a[] = {
+struct Vertex {
+  glm::vec3 position;
+
+  static constexpr std::array<VertexAttribute, 1> Layout() {
+    return {VERTEX_ATTRIBUTE(Vertex, position, 0)};
+  }
+};
+
+Vertex vertices_a[] = {
     // first triangle
-    -0.5f, -0.5f, 0.0f, // bottom left
-    0.0f,  -0.5f, 0.0f, // bottom center
-    0.0f,  0.5f,  0.0f, // top center
+    {{-0.5f, -0.5f, 0.0f}}, // bottom left
+    {{0.0f, -0.5f, 0.0f}},  // bottom center
+    {{0.0f, 0.5f, 0.0f}},   // top center
 };
 
-float vertices_b[] = {
+Vertex vertices_b[] = {
     // second triangle
-    0.5f, -0.5f, 0.0f, // bottom right
-    0.0f, -0.5f, 0.0f, // bottom center
-    0.0f, 0.5f,  0.0f, // top center
+    {{0.5f, -0.5f, 0.0f}}, // bottom right
+    {{0.0f, -0.5f, 0.0f}}, // bottom center
+    {{0.0f, 0.5f, 0.0f}},  // top center
 };
 
 // unsigned int indices[] = {
@@ -63,36 +59,10 @@ const char *fragmentShaderSourceYellow = "#version 330 core\n"
                                          "  FragColor = vec4(255/255.0f, 191/255.0f, 0/255.0f, 1.0f);\n"
                                          "}\0";
 
-void checkShaderCompilationStatus(unsigned int shader, const std::string &name) {
-  int success;
-  char infoLog[512];
-  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-
-  if (!success) {
-    glGetShaderInfoLog(shader, 512, NULL, infoLog);
-    std::cout << "shader compilation failed: " << name << ": " << infoLog << std::endl;
-    exit(EXIT_FAILURE);
-  }
-}
-
-unsigned int setupVertexShader() {
-  unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-  glCompileShader(vertexShader);
-  checkShaderCompilationStatus(vertexShader, "vertex shader");
-  return vertexShader;
-}
-
-unsigned int setupFragmentShader(const char *fragmentShaderSource) {
-  unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-  glCompileShader(fragmentShader);
-  checkShaderCompilationStatus(fragmentShader, "fragment shader");
-  return fragmentShader;
-}
-
 unsigned int setupShaderProgram(const char *fragmentShaderSource) {
-  unsigned int vertexShader = setupVertexShader(), fragmentShader = setupFragmentShader(fragmentShaderSource);
+  unsigned int vertexShader = createShader(vertexShaderSource, GL_VERTEX_SHADER, "vertex shader"),
+               fragmentShader =
+                   createShader(fragmentShaderSource, GL_FRAGMENT_SHADER, "fragment shader");
 
   unsigned int shaderProgram = glCreateProgram();
   glAttachShader(shaderProgram, vertexShader);
@@ -113,93 +83,36 @@ unsigned int setupShaderProgram(const char *fragmentShaderSource) {
   return shaderProgram;
 }
 
-void setupVertexArrayObject(unsigned int &VAO, float *vertices, long vertices_size) {
-  unsigned int VBO;
-  glGenVertexArrays(1, &VAO);
-  glGenBuffers(1, &VBO);
-
-  // 1. Bind Vertex Array Object.
-  glBindVertexArray(VAO);
-
-  // 2. Copy our vertices array into a buffer for OpenGL to use.
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, vertices_size, vertices, GL_STATIC_DRAW);
-
-  // 3. Then set our vertex attribute pointers.
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-  glEnableVertexAttribArray(0);
-
-  // Unbind the VBO. Note that this is allowed, the call to glVertexAttribPointer registered VBO as
-  // the vertex attribute's bound vertex buffer object so afterwards we can safely unbind.
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Unbind the VAO. You can unbind the VAO afterwards so other VAO calls won't accidentally modify
-  // this VAO, but this rarely happens. Modifying other VAOs requires a call to glBindVertexArray
-  // anyway, so we generally don't unbind VAOs (nor VBOs) when it's not directly necessary.
-  glBindVertexArray(0);
-}
-
-// void setupVertexArrayObject(unsigned int &VAO, unsigned int &VBO, unsigned int &EBO) {
-// void setupVertexArrayObject(unsigned int &VAO, unsigned int &VBO) {
-void setupVertexArrayObjects(unsigned int &VAO1, unsigned int &VAO2) {
-  setupVertexArrayObject(VAO1, vertices_a, sizeof(vertices_a));
-  setupVertexArrayObject(VAO2, vertices_b, sizeof(vertices_b));
-}
-
-int main() {
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-
-  GLFWwindow *window = glfwCreateWindow(800, 600, "LearnOpenGL", NULL, NULL);
-  if (window == NULL) {
-    std::cout << "Failed to Create GLFW window" << std::endl;
-    glfwTerminate();
+int main(int argc, char **argv) {
+  auto app = GlfwApplication::Create(GlfwApplication::ParseOptions(argc, argv));
+  if (!app) {
     return -1;
   }
-  glfwMakeContextCurrent(window);
-  glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-
-  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-    std::cout << "Failed to initialize GLAD" << std::endl;
-    return -1;
-  }
-
-  //    glViewport(0, 0, 800, 600);
 
   unsigned int orangeShaderProgram = setupShaderProgram(fragmentShaderSourceOrange);
   unsigned int yellowShaderProgram = setupShaderProgram(fragmentShaderSourceYellow);
 
-  unsigned int VAO1, VAO2; //, VBO1; //, EBO;
-  setupVertexArrayObjects(VAO1, VAO2 /*, EBO*/);
+  Mesh<Vertex> triangle_a(vertices_a, std::size(vertices_a));
+  Mesh<Vertex> triangle_b(vertices_b, std::size(vertices_b));
 
-  while (!glfwWindowShouldClose(window)) {
-    processInput(window);
+  // The scene never changes, so the queue is filled once and replayed every frame, each program
+  // bound once however the draws were added.
+  RenderQueue queue;
+  queue.Add({0, orangeShaderProgram, 0, triangle_a.Vao()}, RenderQueue::Draw::Whole(triangle_a));
+  queue.Add({0, yellowShaderProgram, 0, triangle_b.Vao()}, RenderQueue::Draw::Whole(triangle_b));
 
+  app->Run([&]() {
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-    glUseProgram(orangeShaderProgram);
-
-    glBindVertexArray(VAO1);
-    glDrawArrays(GL_TRIANGLES, 0, 3);
-
-    glUseProgram(yellowShaderProgram);
-    glBindVertexArray(VAO2);
-    glDrawArrays(GL_TRIANGLES, 0, 3);
+    queue.Replay();
 
     glBindVertexArray(0);
 
     // glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  });
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
-  }
-
-  glfwTerminate();
   return 0;
 }
@@ -0,0 +1,32 @@
+#include "instance_buffer.h"
+
+InstanceBuffer::InstanceBuffer(GLenum usage) : usage_(usage) { glGenBuffers(1, &vbo_); }
+
+InstanceBuffer::~InstanceBuffer() { glDeleteBuffers(1, &vbo_); }
+
+void InstanceBuffer::Attach(unsigned int vao, unsigned int buffer, size_t offset) {
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  // Attributes are at most four components wide, so a mat4 is passed as four column vectors.
+  for (unsigned int column = 0; column < 4; column++) {
+    unsigned int location = kModelLocation + column;
+    glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                          (void *)(offset + column * sizeof(glm::vec4)));
+    glEnableVertexAttribArray(location);
+    // Advance once per instance rather than once per vertex.
+    glVertexAttribDivisor(location, 1);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+}
+
+void InstanceBuffer::Upload(const glm::mat4 *models, size_t count) {
+  glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+  glBufferData(GL_ARRAY_BUFFER, count * sizeof(glm::mat4), models, usage_);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  count_ = count;
+}
+
+void InstanceBuffer::DrawArrays(GLenum mode, int first, int count) const {
+  glDrawArraysInstanced(mode, first, count, (GLsizei)count_);
+}
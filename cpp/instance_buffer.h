@@ -0,0 +1,49 @@
+#ifndef LEARNOPENGL_INSTANCE_BUFFER_H
+#define LEARNOPENGL_INSTANCE_BUFFER_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "opengl.h"
+
+/**
+ * A buffer of per-instance model matrices, fed to the vertex shader as a mat4 attribute with a
+ * divisor of one so that a whole set of objects is drawn with a single instanced call.
+ */
+class InstanceBuffer {
+public:
+  // A mat4 attribute occupies four consecutive locations, starting here (see vertex_shader.glsl).
+  static constexpr unsigned int kModelLocation = 2;
+
+  explicit InstanceBuffer(GLenum usage = GL_STATIC_DRAW);
+  InstanceBuffer(const InstanceBuffer &) = delete;
+  InstanceBuffer &operator=(const InstanceBuffer &) = delete;
+  ~InstanceBuffer();
+
+  /**
+   * Sources the model matrix attribute of vao from this buffer, starting at instance first. GL 3.3
+   * has no base instance for draws, so drawing a subrange re-attaches at its first instance.
+   */
+  void Attach(unsigned int vao, size_t first = 0) const {
+    Attach(vao, vbo_, first * sizeof(glm::mat4));
+  }
+
+  /** As above, for matrices stored at offset bytes into another buffer, such as a RingBuffer. */
+  static void Attach(unsigned int vao, unsigned int buffer, size_t offset);
+
+  /** Replaces the buffer contents. The previous storage is orphaned rather than synchronized. */
+  void Upload(const glm::mat4 *models, size_t count);
+  void Upload(const std::vector<glm::mat4> &models) { Upload(models.data(), models.size()); }
+
+  /** Draws every instance with the currently bound vertex array. */
+  void DrawArrays(GLenum mode, int first, int count) const;
+
+  size_t Count() const { return count_; }
+
+private:
+  unsigned int vbo_ = 0;
+  GLenum usage_;
+  size_t count_ = 0;
+};
+
+#endif // LEARNOPENGL_INSTANCE_BUFFER_H
@@ -0,0 +1,28 @@
+#ifndef LEARNOPENGL_MAPPED_FILE_H
+#define LEARNOPENGL_MAPPED_FILE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+/** A read-only memory mapping of a whole file, unmapped on destruction. */
+class MappedFile {
+public:
+  /** Returns nullptr if the file cannot be opened or mapped. */
+  static std::unique_ptr<MappedFile> Open(const std::string &path);
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile();
+
+  const unsigned char *Data() const { return data_; }
+  size_t Size() const { return size_; }
+
+private:
+  MappedFile(const unsigned char *data, size_t size) : data_(data), size_(size) {}
+
+  const unsigned char *data_;
+  size_t size_;
+};
+
+#endif // LEARNOPENGL_MAPPED_FILE_H
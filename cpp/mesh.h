@@ -0,0 +1,265 @@
+#ifndef LEARNOPENGL_MESH_H
+#define LEARNOPENGL_MESH_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "opengl.h"
+
+/**
+ * How a C++ attribute type is passed to glVertexAttribPointer. Only the types specialized here can
+ * appear in a vertex layout; anything else fails to compile.
+ */
+template <typename T>
+struct AttributeFormat;
+
+template <GLenum Type, int Size, bool Normalized = false>
+struct AttributeFormatOf {
+  static constexpr GLenum kType = Type;
+  static constexpr int kSize = Size;
+  static constexpr bool kNormalized = Normalized;
+};
+
+template <>
+struct AttributeFormat<float> : AttributeFormatOf<GL_FLOAT, 1> {};
+template <>
+struct AttributeFormat<glm::vec2> : AttributeFormatOf<GL_FLOAT, 2> {};
+template <>
+struct AttributeFormat<glm::vec3> : AttributeFormatOf<GL_FLOAT, 3> {};
+template <>
+struct AttributeFormat<glm::vec4> : AttributeFormatOf<GL_FLOAT, 4> {};
+
+struct VertexAttribute {
+  unsigned int location;
+  int size;
+  GLenum type;
+  bool normalized;
+  size_t offset;
+  size_t bytes;
+};
+
+template <typename T>
+constexpr VertexAttribute MakeVertexAttribute(unsigned int location, size_t offset) {
+  using Format = AttributeFormat<T>;
+  return {location, Format::kSize, Format::kType, Format::kNormalized, offset, sizeof(T)};
+}
+
+/**
+ * Describes a member of a vertex struct. Vertex types list these in a static constexpr Layout()
+ * function, from which offsets, types and the stride are all derived at compile time:
+ *
+ *   struct Vertex {
+ *     glm::vec3 position;
+ *     glm::vec2 tex_coord;
+ *
+ *     static constexpr std::array<VertexAttribute, 2> Layout() {
+ *       return {VERTEX_ATTRIBUTE(Vertex, position, 0), VERTEX_ATTRIBUTE(Vertex, tex_coord, 1)};
+ *     }
+ *   };
+ */
+#define VERTEX_ATTRIBUTE(Vertex, member, location)                                                 \
+  MakeVertexAttribute<decltype(Vertex::member)>(location, offsetof(Vertex, member))
+
+/** Checks that attributes lie within the vertex and use distinct locations. */
+template <typename Vertex>
+constexpr bool IsValidVertexLayout() {
+  constexpr auto layout = Vertex::Layout();
+  for (size_t i = 0; i < layout.size(); i++) {
+    if (layout[i].offset + layout[i].bytes > sizeof(Vertex)) {
+      return false;
+    }
+    for (size_t j = 0; j < i; j++) {
+      if (layout[i].location == layout[j].location) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * Points the attributes in Vertex::Layout() at the buffer bound to GL_ARRAY_BUFFER, recording them
+ * in the bound vertex array.
+ */
+template <typename Vertex>
+void SetVertexLayout() {
+  for (const VertexAttribute &attribute : Vertex::Layout()) {
+    glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized,
+                          sizeof(Vertex), (void *)attribute.offset);
+    glEnableVertexAttribArray(attribute.location);
+  }
+}
+
+template <typename Index>
+struct IndexFormat;
+template <>
+struct IndexFormat<uint16_t> {
+  static constexpr GLenum kType = GL_UNSIGNED_SHORT;
+};
+template <>
+struct IndexFormat<uint32_t> {
+  static constexpr GLenum kType = GL_UNSIGNED_INT;
+};
+
+constexpr size_t IndexSize(GLenum type) {
+  return type == GL_UNSIGNED_BYTE ? 1 : type == GL_UNSIGNED_SHORT ? 2 : 4;
+}
+
+/** Indices of a type chosen at run time, owned elsewhere (for example by a mapped file). */
+struct IndexSpan {
+  GLenum type = GL_UNSIGNED_INT;
+  size_t count = 0;
+  const void *data = nullptr;
+};
+
+/** Index data whose element type is chosen at run time (see PackIndices). */
+struct IndexData {
+  // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+  GLenum type = GL_UNSIGNED_INT;
+  size_t count = 0;
+  std::vector<uint8_t> bytes;
+
+  IndexSpan Span() const { return {type, count, bytes.data()}; }
+};
+
+/** A range of a mesh's indices, such as a submesh or a meshlet. */
+struct IndexRange {
+  uint32_t first;
+  uint32_t count;
+};
+
+/**
+ * Owns the vertex array, vertex buffer and optional index buffer for one mesh of Vertex, set up
+ * from Vertex::Layout(). Move-only; the GL objects are deleted with the last owner.
+ */
+template <typename Vertex>
+class Mesh {
+public:
+  static_assert(std::is_standard_layout_v<Vertex>, "offsetof requires a standard-layout vertex");
+  static_assert(IsValidVertexLayout<Vertex>(), "invalid vertex layout");
+
+  Mesh(const Vertex *vertices, size_t vertex_count, GLenum usage = GL_STATIC_DRAW)
+      : Mesh(vertices, vertex_count, nullptr, 0, 0, 0, usage) {}
+
+  template <typename Index>
+  Mesh(const Vertex *vertices, size_t vertex_count, const Index *indices, size_t index_count,
+       GLenum usage = GL_STATIC_DRAW)
+      : Mesh(vertices, vertex_count, indices, index_count, sizeof(Index),
+             IndexFormat<Index>::kType, usage) {}
+
+  explicit Mesh(const std::vector<Vertex> &vertices, GLenum usage = GL_STATIC_DRAW)
+      : Mesh(vertices.data(), vertices.size(), usage) {}
+
+  template <typename Index>
+  Mesh(const std::vector<Vertex> &vertices, const std::vector<Index> &indices,
+       GLenum usage = GL_STATIC_DRAW)
+      : Mesh(vertices.data(), vertices.size(), indices.data(), indices.size(), usage) {}
+
+  Mesh(const Vertex *vertices, size_t vertex_count, IndexSpan indices,
+       GLenum usage = GL_STATIC_DRAW)
+      : Mesh(vertices, vertex_count, indices.data, indices.count, IndexSize(indices.type),
+             indices.type, usage) {}
+
+  Mesh(const std::vector<Vertex> &vertices, const IndexData &indices,
+       GLenum usage = GL_STATIC_DRAW)
+      : Mesh(vertices.data(), vertices.size(), indices.Span(), usage) {}
+
+  Mesh(const Mesh &) = delete;
+  Mesh &operator=(const Mesh &) = delete;
+  Mesh(Mesh &&other) noexcept { *this = std::move(other); }
+  Mesh &operator=(Mesh &&other) noexcept {
+    std::swap(vao_, other.vao_);
+    std::swap(vbo_, other.vbo_);
+    std::swap(ebo_, other.ebo_);
+    std::swap(vertex_count_, other.vertex_count_);
+    std::swap(index_count_, other.index_count_);
+    std::swap(index_type_, other.index_type_);
+    return *this;
+  }
+
+  ~Mesh() {
+    if (vao_ != 0) {
+      glDeleteVertexArrays(1, &vao_);
+      glDeleteBuffers(1, &vbo_);
+    }
+    if (ebo_ != 0) {
+      glDeleteBuffers(1, &ebo_);
+    }
+  }
+
+  unsigned int Vao() const { return vao_; }
+  size_t VertexCount() const { return vertex_count_; }
+  size_t IndexCount() const { return index_count_; }
+  // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, or 0 for a non-indexed mesh.
+  GLenum IndexType() const { return index_type_; }
+
+  void Bind() const { glBindVertexArray(vao_); }
+
+  /** Draws the whole mesh, indexed if it has indices. Leaves the vertex array bound. */
+  void Draw(GLenum mode = GL_TRIANGLES) const { DrawInstanced(mode, 1); }
+
+  void DrawInstanced(GLenum mode, int instance_count) const {
+    if (ebo_ != 0) {
+      DrawRangeInstanced(mode, 0, index_count_, instance_count);
+    } else {
+      Bind();
+      glDrawArraysInstanced(mode, 0, (GLsizei)vertex_count_, instance_count);
+    }
+  }
+
+  /** Draws several ranges of the index buffer with a single call, such as the visible meshlets. */
+  void DrawRanges(GLenum mode, const IndexRange *ranges, size_t range_count) const {
+    std::vector<GLsizei> counts(range_count);
+    std::vector<const void *> offsets(range_count);
+    for (size_t i = 0; i < range_count; i++) {
+      counts[i] = (GLsizei)ranges[i].count;
+      offsets[i] = (const void *)(ranges[i].first * IndexSize(index_type_));
+    }
+    Bind();
+    glMultiDrawElements(mode, counts.data(), index_type_, offsets.data(), (GLsizei)range_count);
+  }
+
+  /** Draws count indices starting at first, such as one level of a LOD chain. */
+  void DrawRangeInstanced(GLenum mode, size_t first, size_t count, int instance_count) const {
+    Bind();
+    glDrawElementsInstanced(mode, (GLsizei)count, index_type_,
+                            (void *)(first * IndexSize(index_type_)), instance_count);
+  }
+
+private:
+  Mesh(const Vertex *vertices, size_t vertex_count, const void *indices, size_t index_count,
+       size_t index_size, GLenum index_type, GLenum usage)
+      : vertex_count_(vertex_count), index_count_(index_count), index_type_(index_type) {
+    glGenVertexArrays(1, &vao_);
+    glGenBuffers(1, &vbo_);
+    glBindVertexArray(vao_);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof(Vertex), vertices, usage);
+    // The element buffer binding is part of the vertex array state, so it stays bound to it.
+    if (indices != nullptr) {
+      glGenBuffers(1, &ebo_);
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+      glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * index_size, indices, usage);
+    }
+
+    SetVertexLayout<Vertex>();
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  unsigned int vao_ = 0;
+  unsigned int vbo_ = 0;
+  unsigned int ebo_ = 0;
+  size_t vertex_count_ = 0;
+  size_t index_count_ = 0;
+  GLenum index_type_ = 0;
+};
+
+#endif // LEARNOPENGL_MESH_H
@@ -0,0 +1,249 @@
+#include "mesh_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include "common.h"
+
+namespace {
+
+static_assert(sizeof(MeshFileHeader) == 80, "the mesh file header must not contain padding");
+
+uint64_t alignUp(uint64_t offset) {
+  return (offset + kMeshFileAlignment - 1) / kMeshFileAlignment * kMeshFileAlignment;
+}
+
+void computeBounds(const unsigned char *positions, size_t stride, const uint32_t *indices,
+                   size_t index_count, float bounds_min[3], float bounds_max[3]) {
+  std::fill(bounds_min, bounds_min + 3, index_count > 0 ? std::numeric_limits<float>::max() : 0);
+  std::fill(bounds_max, bounds_max + 3,
+            index_count > 0 ? std::numeric_limits<float>::lowest() : 0);
+  for (size_t i = 0; i < index_count; i++) {
+    float position[3];
+    std::memcpy(position, positions + indices[i] * stride, sizeof(position));
+    for (int axis = 0; axis < 3; axis++) {
+      bounds_min[axis] = std::min(bounds_min[axis], position[axis]);
+      bounds_max[axis] = std::max(bounds_max[axis], position[axis]);
+    }
+  }
+}
+
+// The largest of count indices of index_type, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, at data.
+uint32_t maxIndex(const unsigned char *data, GLenum index_type, uint64_t count) {
+  uint32_t largest = 0;
+  for (uint64_t i = 0; i < count; i++) {
+    uint32_t index = 0;
+    if (index_type == GL_UNSIGNED_SHORT) {
+      uint16_t value;
+      std::memcpy(&value, data + i * sizeof(value), sizeof(value));
+      index = value;
+    } else {
+      std::memcpy(&index, data + i * sizeof(index), sizeof(index));
+    }
+    largest = std::max(largest, index);
+  }
+  return largest;
+}
+
+// The cache of path, if it is at least as new as path, and holds MeshVertex in this version of
+// the format.
+std::unique_ptr<MeshFile> openFreshCache(const std::string &path, const std::string &cache_path) {
+  std::error_code error;
+  auto source_time = std::filesystem::last_write_time(path, error);
+  if (error) {
+    return nullptr;
+  }
+  auto cache_time = std::filesystem::last_write_time(cache_path, error);
+  if (error || cache_time < source_time) {
+    return nullptr;
+  }
+  std::unique_ptr<MeshFile> cache = MeshFile::Open(cache_path);
+  return cache && cache->Matches<MeshVertex>() ? std::move(cache) : nullptr;
+}
+
+// Loads and optimizes path, and writes it to cache_path for next time.
+std::optional<IndexedMesh<MeshVertex>> cookObj(const std::string &path,
+                                               const std::string &cache_path) {
+  std::optional<IndexedMesh<MeshVertex>> mesh = LoadObj(path);
+  if (!mesh) {
+    return std::nullopt;
+  }
+  OptimizeMesh(*mesh);
+  // Write to a temporary file and rename it so that concurrent launches never see a partial file.
+  std::error_code error;
+  std::string temporary = temporaryPathFor(cache_path);
+  if (WriteMeshFile(temporary, *mesh)) {
+    std::filesystem::rename(temporary, cache_path, error);
+  } else {
+    std::filesystem::remove(temporary, error);
+  }
+  return mesh;
+}
+
+} // namespace
+
+bool WriteMeshFile(const std::string &path, const std::vector<VertexAttribute> &layout,
+                   size_t vertex_size, const void *vertices, size_t vertex_count,
+                   size_t position_offset, const std::vector<uint32_t> &indices,
+                   const std::vector<IndexRange> &submeshes) {
+  MeshFileHeader header = {};
+  std::copy(kMeshFileMagic, kMeshFileMagic + 4, header.magic);
+  header.version = kMeshFileVersion;
+  header.vertex_size = vertex_size;
+  header.attribute_count = layout.size();
+  header.vertex_count = vertex_count;
+  header.index_count = indices.size();
+
+  std::vector<MeshFileAttribute> attributes;
+  for (const VertexAttribute &attribute : layout) {
+    attributes.push_back({attribute.location, attribute.size, attribute.type,
+                          attribute.normalized, (uint32_t)attribute.offset});
+  }
+
+  const auto *positions = static_cast<const unsigned char *>(vertices) + position_offset;
+  std::vector<MeshFileSubmesh> table;
+  for (const IndexRange &range : submeshes) {
+    if (range.first > indices.size() || range.count > indices.size() - range.first) {
+      std::cerr << "Error: submesh out of range for " << path << std::endl;
+      return false;
+    }
+    MeshFileSubmesh submesh = {range.first, range.count, {}, {}};
+    computeBounds(positions, vertex_size, indices.data() + range.first, range.count,
+                  submesh.bounds_min, submesh.bounds_max);
+    table.push_back(submesh);
+  }
+  if (submeshes.empty()) {
+    MeshFileSubmesh submesh = {0, (uint32_t)indices.size(), {}, {}};
+    computeBounds(positions, vertex_size, indices.data(), indices.size(), submesh.bounds_min,
+                  submesh.bounds_max);
+    table.push_back(submesh);
+  }
+  header.submesh_count = table.size();
+  computeBounds(positions, vertex_size, indices.data(), indices.size(), header.bounds_min,
+                header.bounds_max);
+
+  IndexData packed = PackIndices(indices, vertex_count);
+  header.index_type = packed.type;
+  header.vertex_offset = alignUp(sizeof(header) + attributes.size() * sizeof(MeshFileAttribute) +
+                                 table.size() * sizeof(MeshFileSubmesh));
+  header.index_offset = alignUp(header.vertex_offset + vertex_count * vertex_size);
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write((const char *)&header, sizeof(header));
+  file.write((const char *)attributes.data(), attributes.size() * sizeof(MeshFileAttribute));
+  file.write((const char *)table.data(), table.size() * sizeof(MeshFileSubmesh));
+  const char padding[kMeshFileAlignment] = {};
+  file.write(padding, header.vertex_offset - file.tellp());
+  file.write((const char *)vertices, vertex_count * vertex_size);
+  file.write(padding, header.index_offset - file.tellp());
+  file.write((const char *)packed.bytes.data(), packed.bytes.size());
+  if (!file) {
+    std::cerr << "Error: failed to write " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<MeshFile> MeshFile::Open(const std::string &path) {
+  std::unique_ptr<MappedFile> file = MappedFile::Open(path);
+  if (!file) {
+    return nullptr;
+  }
+
+  MeshFileHeader header;
+  if (file->Size() < sizeof(header)) {
+    std::cerr << "Error: " << path << " is not a valid mesh file" << std::endl;
+    return nullptr;
+  }
+  std::memcpy(&header, file->Data(), sizeof(header));
+  if (!std::equal(header.magic, header.magic + 4, kMeshFileMagic)) {
+    std::cerr << "Error: " << path << " is not a valid mesh file" << std::endl;
+    return nullptr;
+  }
+  if (header.version != kMeshFileVersion) {
+    return nullptr;
+  }
+
+  // Every size is checked against the file before any offset is trusted.
+  uint64_t size = file->Size();
+  uint64_t tables_size = (uint64_t)header.attribute_count * sizeof(MeshFileAttribute) +
+                         (uint64_t)header.submesh_count * sizeof(MeshFileSubmesh);
+  uint64_t index_size = IndexSize(header.index_type);
+  bool valid = (header.index_type == GL_UNSIGNED_SHORT || header.index_type == GL_UNSIGNED_INT) &&
+               header.vertex_size > 0 && tables_size <= size - sizeof(header) &&
+               header.vertex_offset % kMeshFileAlignment == 0 &&
+               header.index_offset % kMeshFileAlignment == 0 &&
+               header.vertex_offset >= sizeof(header) + tables_size &&
+               header.vertex_offset <= size && header.index_offset <= size &&
+               header.vertex_count <= (size - header.vertex_offset) / header.vertex_size &&
+               header.index_count <= (size - header.index_offset) / index_size;
+  if (valid) {
+    const auto *submeshes = reinterpret_cast<const MeshFileSubmesh *>(
+        file->Data() + sizeof(header) + header.attribute_count * sizeof(MeshFileAttribute));
+    for (uint32_t i = 0; i < header.submesh_count; i++) {
+      valid = valid && submeshes[i].first_index <= header.index_count &&
+              submeshes[i].index_count <= header.index_count - submeshes[i].first_index;
+    }
+  }
+  // Indices are read on the CPU too, e.g. to build meshlets, so each has to name a vertex.
+  if (valid && header.index_count > 0) {
+    valid = maxIndex(file->Data() + header.index_offset, header.index_type, header.index_count) <
+            header.vertex_count;
+  }
+  if (!valid) {
+    std::cerr << "Error: " << path << " is not a valid mesh file" << std::endl;
+    return nullptr;
+  }
+  return std::unique_ptr<MeshFile>(new MeshFile(std::move(file), header));
+}
+
+const MeshFileAttribute *MeshFile::Attributes() const {
+  return reinterpret_cast<const MeshFileAttribute *>(file_->Data() + sizeof(MeshFileHeader));
+}
+
+const MeshFileSubmesh *MeshFile::Submeshes() const {
+  return reinterpret_cast<const MeshFileSubmesh *>(
+      file_->Data() + sizeof(MeshFileHeader) + header_.attribute_count * sizeof(MeshFileAttribute));
+}
+
+bool MeshFile::Matches(const VertexAttribute *layout, size_t attribute_count,
+                       size_t vertex_size) const {
+  if (header_.vertex_size != vertex_size || header_.attribute_count != attribute_count) {
+    return false;
+  }
+  const MeshFileAttribute *attributes = Attributes();
+  for (size_t i = 0; i < attribute_count; i++) {
+    if (attributes[i].location != layout[i].location || attributes[i].size != layout[i].size ||
+        attributes[i].type != layout[i].type ||
+        attributes[i].normalized != (uint32_t)layout[i].normalized ||
+        attributes[i].offset != layout[i].offset) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::unique_ptr<Mesh<MeshVertex>> LoadObjCached(const std::string &path) {
+  std::string cache_path = path + ".mesh";
+  if (std::unique_ptr<MeshFile> cache = openFreshCache(path, cache_path)) {
+    return cache->CreateMesh<MeshVertex>();
+  }
+  std::optional<IndexedMesh<MeshVertex>> mesh = cookObj(path, cache_path);
+  if (!mesh) {
+    return nullptr;
+  }
+  return std::make_unique<Mesh<MeshVertex>>(mesh->vertices,
+                                            PackIndices(mesh->indices, mesh->vertices.size()));
+}
+
+std::optional<IndexedMesh<MeshVertex>> LoadObjCachedMesh(const std::string &path) {
+  std::string cache_path = path + ".mesh";
+  if (std::unique_ptr<MeshFile> cache = openFreshCache(path, cache_path)) {
+    return cache->ReadMesh<MeshVertex>();
+  }
+  return cookObj(path, cache_path);
+}
@@ -0,0 +1,165 @@
+#ifndef LEARNOPENGL_MESH_FILE_H
+#define LEARNOPENGL_MESH_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mapped_file.h"
+#include "mesh.h"
+#include "mesh_loader.h"
+#include "mesh_processing.h"
+
+/**
+ * Layout of a cooked mesh file (.mesh), as written by WriteMeshFile. The header is followed by the
+ * attribute table and the submesh table, then the vertex and index data, each starting on a
+ * kMeshFileAlignment boundary. Vertices and indices are stored exactly as GL consumes them, so a
+ * memory mapping of the file is uploaded without any parsing.
+ */
+struct MeshFileHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t vertex_size;
+  uint32_t attribute_count;
+  uint64_t vertex_count;
+  uint64_t index_count;
+  uint32_t index_type; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+  uint32_t submesh_count;
+  float bounds_min[3];
+  float bounds_max[3];
+  uint64_t vertex_offset; // From the start of the file.
+  uint64_t index_offset;
+};
+
+/** A VertexAttribute with fixed-size fields. */
+struct MeshFileAttribute {
+  uint32_t location;
+  int32_t size;
+  uint32_t type;
+  uint32_t normalized;
+  uint32_t offset;
+};
+
+/** A range of the index buffer with its own bounds, such as the faces using one material. */
+struct MeshFileSubmesh {
+  uint32_t first_index;
+  uint32_t index_count;
+  float bounds_min[3];
+  float bounds_max[3];
+};
+
+constexpr char kMeshFileMagic[4] = {'L', 'M', 'S', 'H'};
+constexpr uint32_t kMeshFileVersion = 1;
+constexpr uint64_t kMeshFileAlignment = 16;
+
+/**
+ * Writes a mesh with the given layout to path in the format above, computing bounds from the
+ * vec3 at position_offset in each vertex. Indices are narrowed with PackIndices. No submeshes
+ * means a single one covering every index. Errors are reported on stderr.
+ */
+bool WriteMeshFile(const std::string &path, const std::vector<VertexAttribute> &layout,
+                   size_t vertex_size, const void *vertices, size_t vertex_count,
+                   size_t position_offset, const std::vector<uint32_t> &indices,
+                   const std::vector<IndexRange> &submeshes = {});
+
+/** As above, for a Vertex with a Layout() and a glm::vec3 position member. */
+template <typename Vertex>
+bool WriteMeshFile(const std::string &path, const IndexedMesh<Vertex> &mesh,
+                   const std::vector<IndexRange> &submeshes = {}) {
+  constexpr auto layout = Vertex::Layout();
+  return WriteMeshFile(path, std::vector<VertexAttribute>(layout.begin(), layout.end()),
+                       sizeof(Vertex), mesh.vertices.data(), mesh.vertices.size(),
+                       offsetof(Vertex, position), mesh.indices, submeshes);
+}
+
+/** A validated, memory-mapped mesh file. */
+class MeshFile {
+public:
+  /**
+   * Returns nullptr if the file cannot be opened or was written by another version of the format
+   * (silently, so callers can fall back to the source), or is not a valid mesh file (reported on
+   * stderr).
+   */
+  static std::unique_ptr<MeshFile> Open(const std::string &path);
+
+  const MeshFileHeader &Header() const { return header_; }
+  const MeshFileAttribute *Attributes() const;
+  const MeshFileSubmesh *Submeshes() const;
+  const void *Vertices() const { return file_->Data() + header_.vertex_offset; }
+  IndexSpan Indices() const {
+    return {header_.index_type, header_.index_count, file_->Data() + header_.index_offset};
+  }
+
+  /** Whether the file was written with exactly this vertex type's layout. */
+  template <typename Vertex>
+  bool Matches() const {
+    constexpr auto layout = Vertex::Layout();
+    return Matches(layout.data(), layout.size(), sizeof(Vertex));
+  }
+
+  /** Uploads the mesh straight from the mapping. Returns nullptr if Vertex does not match. */
+  template <typename Vertex>
+  std::unique_ptr<Mesh<Vertex>> CreateMesh(GLenum usage = GL_STATIC_DRAW) const {
+    if (!Matches<Vertex>()) {
+      return nullptr;
+    }
+    return std::make_unique<Mesh<Vertex>>(static_cast<const Vertex *>(Vertices()),
+                                          header_.vertex_count, Indices(), usage);
+  }
+
+  /**
+   * Copies the mesh out of the mapping, for callers that process it further before uploading it.
+   * Returns nothing if Vertex does not match.
+   */
+  template <typename Vertex>
+  std::optional<IndexedMesh<Vertex>> ReadMesh() const {
+    if (!Matches<Vertex>()) {
+      return std::nullopt;
+    }
+    IndexedMesh<Vertex> mesh;
+    const auto *vertices = static_cast<const Vertex *>(Vertices());
+    mesh.vertices.assign(vertices, vertices + header_.vertex_count);
+    mesh.indices.resize(header_.index_count);
+    const unsigned char *indices = file_->Data() + header_.index_offset;
+    for (size_t i = 0; i < mesh.indices.size(); i++) {
+      if (header_.index_type == GL_UNSIGNED_SHORT) {
+        uint16_t index;
+        std::memcpy(&index, indices + i * sizeof(index), sizeof(index));
+        mesh.indices[i] = index;
+      } else {
+        std::memcpy(&mesh.indices[i], indices + i * sizeof(uint32_t), sizeof(uint32_t));
+      }
+    }
+    return mesh;
+  }
+
+private:
+  MeshFile(std::unique_ptr<MappedFile> file, const MeshFileHeader &header)
+      : file_(std::move(file)), header_(header) {}
+
+  bool Matches(const VertexAttribute *layout, size_t attribute_count, size_t vertex_size) const;
+
+  std::unique_ptr<MappedFile> file_;
+  MeshFileHeader header_;
+};
+
+/**
+ * Loads an OBJ file through a cooked cache next to it (path + ".mesh"). The cache is rebuilt, with
+ * OptimizeMesh applied, when it is missing, older than the OBJ, or from another version; if it
+ * cannot be written the mesh is uploaded from memory instead. Returns nullptr on failure.
+ */
+std::unique_ptr<Mesh<MeshVertex>> LoadObjCached(const std::string &path);
+
+/**
+ * Like LoadObjCached, but returns the mesh in memory rather than uploading it, for callers that
+ * process it further first, such as building meshlets. A fresh cache still saves parsing and
+ * optimizing the OBJ. Returns nothing on failure.
+ */
+std::optional<IndexedMesh<MeshVertex>> LoadObjCachedMesh(const std::string &path);
+
+#endif // LEARNOPENGL_MESH_FILE_H
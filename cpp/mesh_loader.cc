@@ -0,0 +1,372 @@
+#include "mesh_loader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+
+namespace {
+
+// Chunks smaller than this are not worth a thread.
+constexpr size_t kMinChunkSize = 1 << 20;
+
+// Indices are stored 0-based. Relative (negative) ones cannot be resolved until the number of
+// elements in earlier chunks is known, so they are stored relative to the start of their chunk
+// and flagged.
+struct ObjCorner {
+  int32_t position = 0;
+  int32_t tex_coord = -1;
+  int32_t normal = -1;
+  uint8_t relative = 0;
+};
+
+enum RelativeFlag : uint8_t {
+  kRelativePosition = 1,
+  kRelativeTexCoord = 2,
+  kRelativeNormal = 4,
+};
+
+struct ObjChunk {
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec2> tex_coords;
+  std::vector<glm::vec3> normals;
+  // Three per triangle.
+  std::vector<ObjCorner> corners;
+  bool valid = true;
+};
+
+// What a welded corner refers to, once indices are absolute.
+struct ObjVertexKey {
+  uint32_t position;
+  uint32_t tex_coord;
+  uint32_t normal;
+};
+
+constexpr uint32_t kMissing = ~0u;
+
+bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+const char *skipSpaces(const char *p, const char *end) {
+  while (p < end && isSpace(*p)) {
+    p++;
+  }
+  return p;
+}
+
+// A locale-independent decimal parser, much faster than strtof. Digits beyond the 19th only affect
+// the exponent, which is well below float precision.
+bool parseFloat(const char *&p, const char *end, float &value) {
+  static constexpr double kPowersOf10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                           1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                           1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  p = skipSpaces(p, end);
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p++ == '-';
+  }
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  const char *start = p;
+  for (; p < end && *p >= '0' && *p <= '9'; p++) {
+    if (digits < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      digits += mantissa != 0;
+    } else {
+      exponent++;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+      if (digits < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        digits += mantissa != 0;
+        exponent--;
+      }
+    }
+  }
+  if (p == start || (p == start + 1 && *start == '.')) {
+    return false;
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char *q = p + 1;
+    bool negative_exponent = false;
+    if (q < end && (*q == '-' || *q == '+')) {
+      negative_exponent = *q++ == '-';
+    }
+    int e = 0;
+    const char *exponent_start = q;
+    for (; q < end && *q >= '0' && *q <= '9'; q++) {
+      e = std::min(e * 10 + (*q - '0'), 1000);
+    }
+    if (q > exponent_start) {
+      exponent += negative_exponent ? -e : e;
+      p = q;
+    }
+  }
+  double result = (double)mantissa;
+  if (exponent < 0) {
+    result = -exponent <= 22 ? result / kPowersOf10[-exponent] : result * std::pow(10.0, exponent);
+  } else if (exponent > 0) {
+    result = exponent <= 22 ? result * kPowersOf10[exponent] : result * std::pow(10.0, exponent);
+  }
+  value = (float)(negative ? -result : result);
+  return true;
+}
+
+bool parseInt(const char *&p, const char *end, int64_t &value) {
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p++ == '-';
+  }
+  const char *start = p;
+  int64_t result = 0;
+  for (; p < end && *p >= '0' && *p <= '9'; p++) {
+    result = result * 10 + (*p - '0');
+  }
+  value = negative ? -result : result;
+  return p > start && result != 0;
+}
+
+// Converts a 1-based or negative OBJ index into the ObjCorner representation. Out-of-range values
+// are caught by resolveIndex.
+void storeIndex(int64_t index, size_t count, int32_t &stored, uint8_t &relative, uint8_t flag) {
+  int64_t value = index > 0 ? index - 1 : (int64_t)count + index;
+  stored = (int32_t)std::clamp<int64_t>(value, INT32_MIN, INT32_MAX);
+  if (index < 0) {
+    relative |= flag;
+  }
+}
+
+// Parses "v", "v/t", "v//n" or "v/t/n".
+bool parseCorner(const char *&p, const char *end, const ObjChunk &chunk, ObjCorner &corner) {
+  int64_t index;
+  if (!parseInt(p, end, index)) {
+    return false;
+  }
+  storeIndex(index, chunk.positions.size(), corner.position, corner.relative, kRelativePosition);
+  if (p < end && *p == '/') {
+    p++;
+    if (p < end && *p != '/') {
+      if (!parseInt(p, end, index)) {
+        return false;
+      }
+      storeIndex(index, chunk.tex_coords.size(), corner.tex_coord, corner.relative,
+                 kRelativeTexCoord);
+    }
+    if (p < end && *p == '/') {
+      p++;
+      if (!parseInt(p, end, index)) {
+        return false;
+      }
+      storeIndex(index, chunk.normals.size(), corner.normal, corner.relative, kRelativeNormal);
+    }
+  }
+  return p == end || isSpace(*p);
+}
+
+bool parseLine(const char *p, const char *end, ObjChunk &chunk,
+               std::vector<ObjCorner> &polygon) {
+  p = skipSpaces(p, end);
+  const char *keyword = p;
+  while (p < end && !isSpace(*p)) {
+    p++;
+  }
+  std::string_view type(keyword, p - keyword);
+
+  if (type == "v") {
+    glm::vec3 position;
+    bool ok = parseFloat(p, end, position.x) && parseFloat(p, end, position.y) &&
+              parseFloat(p, end, position.z);
+    chunk.positions.push_back(position);
+    return ok;
+  }
+  if (type == "vt") {
+    glm::vec2 tex_coord(0.0f);
+    bool ok = parseFloat(p, end, tex_coord.x);
+    // The second coordinate is optional for 1D textures.
+    parseFloat(p, end, tex_coord.y);
+    chunk.tex_coords.push_back(tex_coord);
+    return ok;
+  }
+  if (type == "vn") {
+    glm::vec3 normal;
+    bool ok = parseFloat(p, end, normal.x) && parseFloat(p, end, normal.y) &&
+              parseFloat(p, end, normal.z);
+    chunk.normals.push_back(normal);
+    return ok;
+  }
+  if (type == "f") {
+    polygon.clear();
+    for (p = skipSpaces(p, end); p < end; p = skipSpaces(p, end)) {
+      ObjCorner corner;
+      if (!parseCorner(p, end, chunk, corner)) {
+        return false;
+      }
+      polygon.push_back(corner);
+    }
+    for (size_t i = 2; i < polygon.size(); i++) {
+      chunk.corners.push_back(polygon[0]);
+      chunk.corners.push_back(polygon[i - 1]);
+      chunk.corners.push_back(polygon[i]);
+    }
+    return polygon.size() >= 3;
+  }
+  return true;
+}
+
+void parseChunk(const char *p, const char *end, ObjChunk &chunk) {
+  std::vector<ObjCorner> polygon;
+  while (p < end) {
+    const char *line_end = static_cast<const char *>(std::memchr(p, '\n', end - p));
+    if (line_end == nullptr) {
+      line_end = end;
+    }
+    const char *comment = static_cast<const char *>(std::memchr(p, '#', line_end - p));
+    if (!parseLine(p, comment != nullptr ? comment : line_end, chunk, polygon)) {
+      chunk.valid = false;
+      return;
+    }
+    p = line_end + 1;
+  }
+}
+
+// Makes an index absolute given the element counts of earlier chunks. Returns false if it is out
+// of range.
+bool resolveIndex(int64_t stored, bool relative, size_t offset, size_t total, uint32_t &index) {
+  int64_t absolute = relative ? stored + (int64_t)offset : stored;
+  if (absolute < 0 || absolute >= (int64_t)total) {
+    return false;
+  }
+  index = (uint32_t)absolute;
+  return true;
+}
+
+template <typename Function>
+void parallelFor(size_t count, unsigned int threads, Function function) {
+  std::vector<std::thread> workers;
+  for (unsigned int t = 1; t < threads && t < count; t++) {
+    workers.emplace_back([&, t]() {
+      for (size_t i = t; i < count; i += threads) {
+        function(i);
+      }
+    });
+  }
+  for (size_t i = 0; i < count; i += std::max(1u, threads)) {
+    function(i);
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+} // namespace
+
+std::optional<IndexedMesh<MeshVertex>> LoadObj(const std::string &path, unsigned int threads) {
+  std::unique_ptr<MappedFile> file = MappedFile::Open(path);
+  if (!file) {
+    std::cerr << "Error: failed to open " << path << std::endl;
+    return std::nullopt;
+  }
+  const char *data = reinterpret_cast<const char *>(file->Data());
+  const char *data_end = data + file->Size();
+
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  size_t chunk_count = std::max<size_t>(1, std::min<size_t>(threads, file->Size() / kMinChunkSize));
+
+  // Split at line boundaries.
+  std::vector<const char *> boundaries(chunk_count + 1, data_end);
+  boundaries[0] = data;
+  for (size_t i = 1; i < chunk_count; i++) {
+    const char *guess = std::max(data + file->Size() * i / chunk_count, boundaries[i - 1]);
+    const char *newline = static_cast<const char *>(std::memchr(guess, '\n', data_end - guess));
+    boundaries[i] = newline != nullptr ? newline + 1 : data_end;
+  }
+
+  std::vector<ObjChunk> chunks(chunk_count);
+  parallelFor(chunk_count, threads, [&](size_t i) {
+    parseChunk(boundaries[i], boundaries[i + 1], chunks[i]);
+  });
+
+  // Where each chunk's elements start in the concatenated arrays.
+  std::vector<size_t> position_offset(chunk_count + 1, 0);
+  std::vector<size_t> tex_coord_offset(chunk_count + 1, 0);
+  std::vector<size_t> normal_offset(chunk_count + 1, 0);
+  std::vector<size_t> corner_offset(chunk_count + 1, 0);
+  for (size_t i = 0; i < chunk_count; i++) {
+    if (!chunks[i].valid) {
+      std::cerr << "Error: " << path << " is not a valid OBJ file" << std::endl;
+      return std::nullopt;
+    }
+    position_offset[i + 1] = position_offset[i] + chunks[i].positions.size();
+    tex_coord_offset[i + 1] = tex_coord_offset[i] + chunks[i].tex_coords.size();
+    normal_offset[i + 1] = normal_offset[i] + chunks[i].normals.size();
+    corner_offset[i + 1] = corner_offset[i] + chunks[i].corners.size();
+  }
+  size_t corner_count = corner_offset[chunk_count];
+  if (corner_count > kMissing) {
+    std::cerr << "Error: " << path << " has too many triangles" << std::endl;
+    return std::nullopt;
+  }
+
+  std::vector<glm::vec3> positions(position_offset[chunk_count]);
+  std::vector<glm::vec2> tex_coords(tex_coord_offset[chunk_count]);
+  std::vector<glm::vec3> normals(normal_offset[chunk_count]);
+  std::vector<ObjVertexKey> keys(corner_count);
+  std::vector<char> resolved(chunk_count, true);
+  parallelFor(chunk_count, threads, [&](size_t i) {
+    ObjChunk &chunk = chunks[i];
+    std::copy(chunk.positions.begin(), chunk.positions.end(),
+              positions.begin() + position_offset[i]);
+    std::copy(chunk.tex_coords.begin(), chunk.tex_coords.end(),
+              tex_coords.begin() + tex_coord_offset[i]);
+    std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + normal_offset[i]);
+    for (size_t c = 0; c < chunk.corners.size(); c++) {
+      const ObjCorner &corner = chunk.corners[c];
+      ObjVertexKey &key = keys[corner_offset[i] + c];
+      key.tex_coord = key.normal = kMissing;
+      bool ok = resolveIndex(corner.position, corner.relative & kRelativePosition,
+                             position_offset[i], positions.size(), key.position);
+      if (corner.tex_coord >= 0 || corner.relative & kRelativeTexCoord) {
+        ok &= resolveIndex(corner.tex_coord, corner.relative & kRelativeTexCoord,
+                           tex_coord_offset[i], tex_coords.size(), key.tex_coord);
+      }
+      if (corner.normal >= 0 || corner.relative & kRelativeNormal) {
+        ok &= resolveIndex(corner.normal, corner.relative & kRelativeNormal, normal_offset[i],
+                           normals.size(), key.normal);
+      }
+      if (!ok) {
+        resolved[i] = false;
+        return;
+      }
+    }
+    chunk = ObjChunk();
+  });
+  if (std::find(resolved.begin(), resolved.end(), false) != resolved.end()) {
+    std::cerr << "Error: " << path << " has a face index out of range" << std::endl;
+    return std::nullopt;
+  }
+
+  // Welding the index triples is much cheaper than welding the expanded vertices, and equivalent.
+  IndexedMesh<MeshVertex> mesh;
+  mesh.indices.resize(corner_count);
+  size_t vertex_count =
+      GenerateVertexRemap(keys.data(), corner_count, sizeof(ObjVertexKey), mesh.indices.data());
+  mesh.vertices.resize(vertex_count);
+  for (size_t i = 0; i < corner_count; i++) {
+    const ObjVertexKey &key = keys[i];
+    MeshVertex &vertex = mesh.vertices[mesh.indices[i]];
+    vertex.position = positions[key.position];
+    vertex.tex_coord = key.tex_coord != kMissing ? tex_coords[key.tex_coord] : glm::vec2(0.0f);
+    vertex.normal = key.normal != kMissing ? normals[key.normal] : glm::vec3(0.0f);
+  }
+  return mesh;
+}
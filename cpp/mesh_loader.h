@@ -0,0 +1,35 @@
+#ifndef LEARNOPENGL_MESH_LOADER_H
+#define LEARNOPENGL_MESH_LOADER_H
+
+#include <glm/glm.hpp>
+#include <optional>
+#include <string>
+
+#include "mesh.h"
+#include "mesh_processing.h"
+
+/** The vertex format meshes are loaded into. Attributes missing from the file are zero. */
+struct MeshVertex {
+  // Locations 2 through 5 hold the instance model matrix (see InstanceBuffer).
+  static constexpr unsigned int kNormalLocation = 6;
+
+  glm::vec3 position;
+  glm::vec2 tex_coord;
+  glm::vec3 normal;
+
+  static constexpr std::array<VertexAttribute, 3> Layout() {
+    return {VERTEX_ATTRIBUTE(MeshVertex, position, 0), VERTEX_ATTRIBUTE(MeshVertex, tex_coord, 1),
+            VERTEX_ATTRIBUTE(MeshVertex, normal, kNormalLocation)};
+  }
+};
+
+/**
+ * Loads the geometry of a Wavefront OBJ file: v, vt, vn and f lines, with polygons triangulated
+ * as fans and negative indices resolved. Everything else (groups, materials, smoothing) is
+ * ignored. The file is memory-mapped and split into chunks at line boundaries that are parsed in
+ * parallel; zero threads means one per hardware thread. Identical corners are welded, so the
+ * result is ready for OptimizeMesh.
+ */
+std::optional<IndexedMesh<MeshVertex>> LoadObj(const std::string &path, unsigned int threads = 0);
+
+#endif // LEARNOPENGL_MESH_LOADER_H
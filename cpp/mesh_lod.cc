@@ -0,0 +1,330 @@
+#include "mesh_lod.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+
+// The sum of squared distances to a set of planes, as the symmetric 4x4 matrix of Garland and
+// Heckbert, with the total plane weight so that errors can be reported as distances.
+struct Quadric {
+  double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+  double b0 = 0, b1 = 0, b2 = 0, c = 0;
+  double weight = 0;
+
+  static Quadric Plane(const glm::vec3 &normal, float distance, float weight) {
+    Quadric q;
+    double a = normal.x, b = normal.y, c = normal.z, d = distance;
+    q.a00 = a * a * weight;
+    q.a01 = a * b * weight;
+    q.a02 = a * c * weight;
+    q.a11 = b * b * weight;
+    q.a12 = b * c * weight;
+    q.a22 = c * c * weight;
+    q.b0 = a * d * weight;
+    q.b1 = b * d * weight;
+    q.b2 = c * d * weight;
+    q.c = d * d * weight;
+    q.weight = weight;
+    return q;
+  }
+
+  Quadric &operator+=(const Quadric &o) {
+    a00 += o.a00, a01 += o.a01, a02 += o.a02, a11 += o.a11, a12 += o.a12, a22 += o.a22;
+    b0 += o.b0, b1 += o.b1, b2 += o.b2, c += o.c;
+    weight += o.weight;
+    return *this;
+  }
+
+  /** Weighted sum of squared distances from p to the planes. */
+  double Error(const glm::vec3 &p) const {
+    double x = p.x, y = p.y, z = p.z;
+    double e = a00 * x * x + a11 * y * y + a22 * z * z +
+               2 * (a01 * x * y + a02 * x * z + a12 * y * z + b0 * x + b1 * y + b2 * z) + c;
+    return std::max(e, 0.0);
+  }
+};
+
+struct Collapse {
+  uint32_t from;
+  uint32_t to;
+  // Mean squared distance.
+  double cost;
+};
+
+uint64_t edgeKey(uint32_t a, uint32_t b) {
+  return a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a;
+}
+
+glm::vec3 triangleNormal(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c) {
+  return glm::cross(b - a, c - a);
+}
+
+float extentOf(const std::vector<glm::vec3> &positions) {
+  if (positions.empty()) {
+    return 0.0f;
+  }
+  glm::vec3 low = positions[0], high = positions[0];
+  for (const glm::vec3 &p : positions) {
+    low = glm::min(low, p);
+    high = glm::max(high, p);
+  }
+  glm::vec3 size = high - low;
+  return std::max(size.x, std::max(size.y, size.z));
+}
+
+std::vector<glm::vec3> gatherPositions(const float *positions, size_t vertex_count,
+                                       size_t position_stride) {
+  std::vector<glm::vec3> result(vertex_count);
+  const auto *bytes = reinterpret_cast<const unsigned char *>(positions);
+  for (size_t i = 0; i < vertex_count; i++) {
+    std::memcpy(&result[i], bytes + i * position_stride, sizeof(glm::vec3));
+  }
+  return result;
+}
+
+} // namespace
+
+size_t SimplifyMesh(uint32_t *destination, const uint32_t *indices, size_t index_count,
+                    const float *positions, size_t vertex_count, size_t position_stride,
+                    size_t target_index_count, float target_error, float *result_error) {
+  std::vector<glm::vec3> p = gatherPositions(positions, vertex_count, position_stride);
+  std::vector<uint32_t> triangles(indices, indices + index_count);
+  double max_cost = (double)target_error * target_error;
+  double reached_cost = 0.0;
+
+  // Vertices that share a position are seams; vertices on edges used by other than two triangles
+  // are borders (or non-manifold). Edges are compared by position so seams don't count as borders.
+  std::vector<uint32_t> position_id(vertex_count);
+  size_t position_count =
+      GenerateVertexRemap(p.data(), vertex_count, sizeof(glm::vec3), position_id.data());
+  std::vector<unsigned int> vertices_at_position(position_count, 0);
+  for (size_t v = 0; v < vertex_count; v++) {
+    vertices_at_position[position_id[v]]++;
+  }
+  std::vector<bool> locked(vertex_count, false);
+  std::unordered_map<uint64_t, int> edge_uses;
+  edge_uses.reserve(index_count);
+  for (size_t i = 0; i < index_count; i += 3) {
+    for (int e = 0; e < 3; e++) {
+      edge_uses[edgeKey(position_id[indices[i + e]], position_id[indices[i + (e + 1) % 3]])]++;
+    }
+  }
+  for (size_t i = 0; i < index_count; i += 3) {
+    for (int e = 0; e < 3; e++) {
+      uint32_t a = indices[i + e], b = indices[i + (e + 1) % 3];
+      if (edge_uses[edgeKey(position_id[a], position_id[b])] != 2) {
+        locked[a] = locked[b] = true;
+      }
+    }
+  }
+  for (size_t v = 0; v < vertex_count; v++) {
+    locked[v] = locked[v] || vertices_at_position[position_id[v]] > 1;
+  }
+
+  std::vector<Quadric> quadrics(vertex_count);
+  for (size_t i = 0; i < index_count; i += 3) {
+    const glm::vec3 &a = p[indices[i]], &b = p[indices[i + 1]], &c = p[indices[i + 2]];
+    glm::vec3 normal = triangleNormal(a, b, c);
+    float area = glm::length(normal);
+    if (area > 0.0f) {
+      normal /= area;
+      Quadric plane = Quadric::Plane(normal, -glm::dot(normal, a), area * 0.5f);
+      for (int k = 0; k < 3; k++) {
+        quadrics[indices[i + k]] += plane;
+      }
+    }
+  }
+
+  std::vector<Collapse> collapses;
+  std::vector<size_t> first_adjacent(vertex_count + 1);
+  std::vector<uint32_t> adjacency;
+  std::vector<bool> touched(vertex_count);
+  std::vector<uint32_t> remap(vertex_count);
+
+  while (triangles.size() > target_index_count) {
+    collapses.clear();
+    for (size_t i = 0; i < triangles.size(); i += 3) {
+      for (int e = 0; e < 3; e++) {
+        uint32_t a = triangles[i + e], b = triangles[i + (e + 1) % 3];
+        for (auto [from, to] : {std::pair(a, b), std::pair(b, a)}) {
+          if (!locked[from]) {
+            Quadric q = quadrics[from];
+            q += quadrics[to];
+            double cost = q.weight > 0 ? q.Error(p[to]) / q.weight : 0.0;
+            if (cost <= max_cost) {
+              collapses.push_back({from, to, cost});
+            }
+          }
+        }
+      }
+    }
+    if (collapses.empty()) {
+      break;
+    }
+    std::sort(collapses.begin(), collapses.end(),
+              [](const Collapse &x, const Collapse &y) { return x.cost < y.cost; });
+
+    // Triangles around each vertex, to check collapses for flipped faces.
+    std::fill(first_adjacent.begin(), first_adjacent.end(), 0);
+    for (uint32_t v : triangles) {
+      first_adjacent[v + 1]++;
+    }
+    for (size_t v = 0; v < vertex_count; v++) {
+      first_adjacent[v + 1] += first_adjacent[v];
+    }
+    adjacency.resize(triangles.size());
+    {
+      std::vector<size_t> fill(first_adjacent.begin(), first_adjacent.end() - 1);
+      for (size_t i = 0; i < triangles.size(); i++) {
+        adjacency[fill[triangles[i]]++] = (uint32_t)(i / 3);
+      }
+    }
+
+    // Each collapse removes about two triangles. Vertices around a collapse are not touched again
+    // in the same pass, so every flip check sees the geometry it will actually produce.
+    size_t triangles_to_remove = (triangles.size() - target_index_count) / 3;
+    size_t removed = 0;
+    std::fill(touched.begin(), touched.end(), false);
+    for (size_t v = 0; v < vertex_count; v++) {
+      remap[v] = (uint32_t)v;
+    }
+    for (const Collapse &collapse : collapses) {
+      if (removed >= triangles_to_remove) {
+        break;
+      }
+      if (touched[collapse.from] || touched[collapse.to]) {
+        continue;
+      }
+      bool flips = false;
+      size_t removes = 0;
+      for (size_t j = first_adjacent[collapse.from]; j < first_adjacent[collapse.from + 1]; j++) {
+        const uint32_t *t = &triangles[adjacency[j] * 3];
+        if (t[0] == collapse.to || t[1] == collapse.to || t[2] == collapse.to) {
+          removes++;
+          continue;
+        }
+        glm::vec3 before = triangleNormal(p[t[0]], p[t[1]], p[t[2]]);
+        glm::vec3 moved[3] = {p[t[0]], p[t[1]], p[t[2]]};
+        for (int k = 0; k < 3; k++) {
+          if (t[k] == collapse.from) {
+            moved[k] = p[collapse.to];
+          }
+        }
+        if (glm::dot(before, triangleNormal(moved[0], moved[1], moved[2])) <= 0.0f) {
+          flips = true;
+          break;
+        }
+      }
+      if (flips) {
+        continue;
+      }
+
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to] += quadrics[collapse.from];
+      reached_cost = std::max(reached_cost, collapse.cost);
+      removed += removes;
+      for (size_t j = first_adjacent[collapse.from]; j < first_adjacent[collapse.from + 1]; j++) {
+        const uint32_t *t = &triangles[adjacency[j] * 3];
+        touched[t[0]] = touched[t[1]] = touched[t[2]] = true;
+      }
+    }
+    if (removed == 0) {
+      break;
+    }
+
+    size_t write = 0;
+    for (size_t i = 0; i < triangles.size(); i += 3) {
+      uint32_t a = remap[triangles[i]], b = remap[triangles[i + 1]], c = remap[triangles[i + 2]];
+      if (a != b && b != c && a != c) {
+        triangles[write++] = a;
+        triangles[write++] = b;
+        triangles[write++] = c;
+      }
+    }
+    triangles.resize(write);
+  }
+
+  std::copy(triangles.begin(), triangles.end(), destination);
+  if (result_error != nullptr) {
+    *result_error = (float)std::sqrt(reached_cost);
+  }
+  return triangles.size();
+}
+
+std::vector<LodLevel> BuildLodChain(std::vector<uint32_t> &indices, const float *positions,
+                                    size_t vertex_count, size_t position_stride,
+                                    size_t max_levels, float reduction, float max_error) {
+  std::vector<LodLevel> levels = {{0, (uint32_t)indices.size(), 0.0f}};
+  float limit = max_error * extentOf(gatherPositions(positions, vertex_count, position_stride));
+
+  std::vector<uint32_t> level(indices.begin(), indices.end());
+  while (levels.size() < max_levels) {
+    size_t previous_count = levels.back().index_count;
+    size_t target = (size_t)(previous_count / 3 * reduction) * 3;
+    float error = 0.0f;
+    // Simplifying the previous level rather than the original is faster, and errors only grow.
+    size_t count = SimplifyMesh(level.data(), level.data(), previous_count, positions,
+                                vertex_count, position_stride, target, limit, &error);
+    if (count == 0 || count > previous_count * 0.9) {
+      break;
+    }
+    std::vector<uint32_t> optimized(level.begin(), level.begin() + count);
+    OptimizeVertexCache(optimized.data(), optimized.data(), count, vertex_count);
+    levels.push_back({(uint32_t)indices.size(), (uint32_t)count,
+                      std::max(error, levels.back().error)});
+    indices.insert(indices.end(), optimized.begin(), optimized.end());
+  }
+  return levels;
+}
+
+BoundingSphere ComputeBoundingSphere(const float *positions, size_t vertex_count,
+                                     size_t position_stride) {
+  std::vector<glm::vec3> p = gatherPositions(positions, vertex_count, position_stride);
+  if (p.empty()) {
+    return {glm::vec3(0.0f), 0.0f};
+  }
+  // Ritter's algorithm: start from two far-apart points, then grow to cover any outliers.
+  auto farthest = [&](const glm::vec3 &from) {
+    size_t best = 0;
+    for (size_t i = 1; i < p.size(); i++) {
+      if (glm::dot(p[i] - from, p[i] - from) > glm::dot(p[best] - from, p[best] - from)) {
+        best = i;
+      }
+    }
+    return p[best];
+  };
+  glm::vec3 a = farthest(p[0]);
+  glm::vec3 b = farthest(a);
+  BoundingSphere sphere = {(a + b) * 0.5f, glm::length(b - a) * 0.5f};
+  for (const glm::vec3 &point : p) {
+    float distance = glm::length(point - sphere.center);
+    if (distance > sphere.radius) {
+      float radius = (sphere.radius + distance) * 0.5f;
+      sphere.center += (point - sphere.center) * ((radius - sphere.radius) / distance);
+      sphere.radius = radius;
+    }
+  }
+  return sphere;
+}
+
+size_t SelectLod(const std::vector<LodLevel> &levels, const glm::vec3 &center, float radius,
+                 float scale, const Camera &camera, float viewport_height, float pixel_error) {
+  float distance = glm::length(center - camera.Position()) - radius;
+  if (levels.size() <= 1 || distance <= 0.0f) {
+    return 0;
+  }
+  // World-space size of one pixel at that distance.
+  float pixel_size =
+      2.0f * distance * std::tan(glm::radians(camera.Zoom()) * 0.5f) / viewport_height;
+  size_t selected = 0;
+  for (size_t i = 1; i < levels.size(); i++) {
+    if (levels[i].error * scale <= pixel_error * pixel_size) {
+      selected = i;
+    }
+  }
+  return selected;
+}
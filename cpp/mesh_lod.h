@@ -0,0 +1,77 @@
+#ifndef LEARNOPENGL_MESH_LOD_H
+#define LEARNOPENGL_MESH_LOD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "camera.h"
+#include "mesh_processing.h"
+
+/**
+ * Simplifies a triangle list by collapsing edges in order of quadric error (Garland and Heckbert,
+ * "Surface Simplification Using Quadric Error Metrics"). Vertices only ever move onto a
+ * neighbour, so every simplified index list can share the original vertex buffer. Vertices on
+ * open borders and attribute seams (several vertices at one position) stay where they are, which
+ * keeps the mesh closed and its texture coordinates intact.
+ *
+ * Stops at target_index_count or before a collapse would move the surface by more than
+ * target_error, in the units of the positions. Writes the result to destination, which must hold
+ * index_count indices, and returns its length; result_error receives the error reached.
+ */
+size_t SimplifyMesh(uint32_t *destination, const uint32_t *indices, size_t index_count,
+                    const float *positions, size_t vertex_count, size_t position_stride,
+                    size_t target_index_count, float target_error, float *result_error = nullptr);
+
+/** A range of a mesh's index buffer, and how far it strays from the full-detail surface. */
+struct LodLevel {
+  uint32_t first_index;
+  uint32_t index_count;
+  float error;
+};
+
+/**
+ * Appends successively simpler versions of mesh.indices to it, each aiming for reduction times the
+ * triangles of the one before and vertex-cache optimized. Stops after max_levels in total, or when
+ * a level would deviate by more than max_error relative to the mesh's extent, or would barely
+ * shrink. Level 0 is the original mesh. Vertex needs a glm::vec3 position member.
+ */
+template <typename Vertex>
+std::vector<LodLevel> BuildLodChain(IndexedMesh<Vertex> &mesh, size_t max_levels = 4,
+                                    float reduction = 0.5f, float max_error = 0.05f);
+
+/** A sphere enclosing a set of positions; not minimal, but within a few percent. */
+struct BoundingSphere {
+  glm::vec3 center;
+  float radius;
+};
+
+BoundingSphere ComputeBoundingSphere(const float *positions, size_t vertex_count,
+                                     size_t position_stride);
+
+/**
+ * Picks the coarsest level whose error, projected from the nearest point of the object's bounding
+ * sphere for camera, stays within pixel_error pixels of a viewport viewport_height pixels tall.
+ * center and radius are in world space; scale converts the levels' errors to world space.
+ */
+size_t SelectLod(const std::vector<LodLevel> &levels, const glm::vec3 &center, float radius,
+                 float scale, const Camera &camera, float viewport_height,
+                 float pixel_error = 1.0f);
+
+/** The part of BuildLodChain that does not depend on the vertex type. */
+std::vector<LodLevel> BuildLodChain(std::vector<uint32_t> &indices, const float *positions,
+                                    size_t vertex_count, size_t position_stride,
+                                    size_t max_levels, float reduction, float max_error);
+
+template <typename Vertex>
+std::vector<LodLevel> BuildLodChain(IndexedMesh<Vertex> &mesh, size_t max_levels,
+                                    float reduction, float max_error) {
+  if (mesh.vertices.empty()) {
+    return {};
+  }
+  return BuildLodChain(mesh.indices, &mesh.vertices[0].position.x, mesh.vertices.size(),
+                       sizeof(Vertex), max_levels, reduction, max_error);
+}
+
+#endif // LEARNOPENGL_MESH_LOD_H
@@ -0,0 +1,145 @@
+#ifndef LEARNOPENGL_MESH_POOL_H
+#define LEARNOPENGL_MESH_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "mesh.h"
+#include "mesh_processing.h"
+#include "offset_allocator.h"
+#include "opengl.h"
+
+/** Where a mesh lives in a MeshPool's buffers. */
+struct PooledMesh {
+  OffsetAllocator::Allocation vertices;
+  OffsetAllocator::Allocation indices;
+  uint32_t vertex_count = 0;
+  uint32_t index_count = 0;
+
+  // Indices are stored relative to the mesh's first vertex; draws add this back.
+  int BaseVertex() const { return (int)vertices.offset; }
+  uint32_t FirstIndex() const { return indices.offset; }
+};
+
+/**
+ * Many meshes of Vertex in one vertex buffer and one index buffer, carved into per-mesh ranges by
+ * OffsetAllocators, behind a single vertex array. Switching meshes is just a different first index
+ * and base vertex in the draw call, so the vertex array is bound once for all of them, and
+ * consecutive meshes can be merged into multi-draws.
+ *
+ * Indices are Index, relative to each mesh's base vertex, so uint16_t works for any number of
+ * meshes as long as each has at most 65536 vertices.
+ */
+template <typename Vertex, typename Index = uint32_t>
+class MeshPool {
+public:
+  static_assert(IsValidVertexLayout<Vertex>(), "invalid vertex layout");
+
+  MeshPool(uint32_t vertex_capacity, uint32_t index_capacity, GLenum usage = GL_STATIC_DRAW)
+      : vertex_allocator_(vertex_capacity), index_allocator_(index_capacity) {
+    glGenVertexArrays(1, &vao_);
+    glGenBuffers(1, &vbo_);
+    glGenBuffers(1, &ebo_);
+    glBindVertexArray(vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferData(GL_ARRAY_BUFFER, (size_t)vertex_capacity * sizeof(Vertex), nullptr, usage);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (size_t)index_capacity * sizeof(Index), nullptr, usage);
+    SetVertexLayout<Vertex>();
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  MeshPool(const MeshPool &) = delete;
+  MeshPool &operator=(const MeshPool &) = delete;
+
+  ~MeshPool() {
+    glDeleteVertexArrays(1, &vao_);
+    glDeleteBuffers(1, &vbo_);
+    glDeleteBuffers(1, &ebo_);
+  }
+
+  /** Copies a mesh into the pool. Returns std::nullopt, reported on stderr, if it does not fit. */
+  std::optional<PooledMesh> Add(const Vertex *vertices, size_t vertex_count,
+                                const uint32_t *indices, size_t index_count) {
+    constexpr size_t kMaxVertices = (size_t)std::numeric_limits<Index>::max() + 1;
+    if (vertex_count == 0 || vertex_count > kMaxVertices || index_count == 0) {
+      std::cerr << "Error: a pooled mesh needs between 1 and " << kMaxVertices
+                << " vertices and at least one index" << std::endl;
+      return std::nullopt;
+    }
+    PooledMesh mesh;
+    mesh.vertices = vertex_allocator_.Allocate((uint32_t)vertex_count);
+    mesh.indices = index_allocator_.Allocate((uint32_t)index_count);
+    if (mesh.vertices.offset == OffsetAllocator::kNoSpace ||
+        mesh.indices.offset == OffsetAllocator::kNoSpace) {
+      std::cerr << "Error: mesh pool is full" << std::endl;
+      vertex_allocator_.Free(mesh.vertices);
+      index_allocator_.Free(mesh.indices);
+      return std::nullopt;
+    }
+    mesh.vertex_count = (uint32_t)vertex_count;
+    mesh.index_count = (uint32_t)index_count;
+
+    std::vector<Index> narrowed(indices, indices + index_count);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferSubData(GL_ARRAY_BUFFER, (size_t)mesh.vertices.offset * sizeof(Vertex),
+                    vertex_count * sizeof(Vertex), vertices);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // The element buffer binding belongs to the vertex array, so bind that to reach it.
+    glBindVertexArray(vao_);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (size_t)mesh.indices.offset * sizeof(Index),
+                    index_count * sizeof(Index), narrowed.data());
+    glBindVertexArray(0);
+    return mesh;
+  }
+
+  std::optional<PooledMesh> Add(const IndexedMesh<Vertex> &mesh) {
+    return Add(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(),
+               mesh.indices.size());
+  }
+
+  /** Returns a mesh's ranges to the pool. Its data stays until another mesh overwrites it. */
+  void Remove(const PooledMesh &mesh) {
+    vertex_allocator_.Free(mesh.vertices);
+    index_allocator_.Free(mesh.indices);
+  }
+
+  unsigned int Vao() const { return vao_; }
+  GLenum IndexType() const { return IndexFormat<Index>::kType; }
+  const OffsetAllocator &VertexAllocator() const { return vertex_allocator_; }
+  const OffsetAllocator &IndexAllocator() const { return index_allocator_; }
+
+  /** Binds the shared vertex array. The draw calls below expect it to be bound. */
+  void Bind() const { glBindVertexArray(vao_); }
+
+  void Draw(const PooledMesh &mesh, GLenum mode = GL_TRIANGLES) const {
+    glDrawElementsBaseVertex(mode, (GLsizei)mesh.index_count, IndexType(),
+                             (void *)(mesh.FirstIndex() * sizeof(Index)), mesh.BaseVertex());
+  }
+
+  void DrawInstanced(const PooledMesh &mesh, GLenum mode, int instance_count) const {
+    DrawRangeInstanced(mesh, 0, mesh.index_count, mode, instance_count);
+  }
+
+  /** Draws count of the mesh's indices starting at its index first, such as one LOD level. */
+  void DrawRangeInstanced(const PooledMesh &mesh, size_t first, size_t count, GLenum mode,
+                          int instance_count) const {
+    glDrawElementsInstancedBaseVertex(
+        mode, (GLsizei)count, IndexType(),
+        (void *)((mesh.FirstIndex() + first) * sizeof(Index)), instance_count, mesh.BaseVertex());
+  }
+
+private:
+  unsigned int vao_ = 0;
+  unsigned int vbo_ = 0;
+  unsigned int ebo_ = 0;
+  OffsetAllocator vertex_allocator_;
+  OffsetAllocator index_allocator_;
+};
+
+#endif // LEARNOPENGL_MESH_POOL_H
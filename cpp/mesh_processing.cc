@@ -0,0 +1,397 @@
+#include "mesh_processing.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+constexpr uint32_t kEmptySlot = std::numeric_limits<uint32_t>::max();
+
+// MurmurHash2 over the vertex bytes, four at a time.
+uint32_t hashVertex(const unsigned char *vertex, size_t size) {
+  constexpr uint32_t m = 0x5bd1e995;
+  uint32_t h = (uint32_t)size;
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    uint32_t k;
+    std::memcpy(&k, vertex + i, 4);
+    k *= m;
+    k ^= k >> 24;
+    k *= m;
+    h = (h * m) ^ k;
+  }
+  for (; i < size; i++) {
+    h = (h ^ vertex[i]) * m;
+  }
+  h ^= h >> 13;
+  h *= m;
+  h ^= h >> 15;
+  return h;
+}
+
+// Forsyth's scoring: the three most recently used vertices score a fixed amount so the next
+// triangle doesn't simply reuse the last one's edge, older entries decay with their age, and
+// vertices with few remaining triangles are boosted so they are finished off rather than left as
+// isolated triangles later.
+constexpr size_t kForsythCacheSize = 32;
+constexpr unsigned int kMaxValence = 64;
+
+struct ForsythTables {
+  float cache[kForsythCacheSize];
+  float valence[kMaxValence];
+
+  ForsythTables() {
+    for (size_t i = 0; i < kForsythCacheSize; i++) {
+      cache[i] = i < 3 ? 0.75f
+                       : std::pow(1.0f - (float)(i - 3) / (kForsythCacheSize - 3), 1.5f);
+    }
+    valence[0] = 0.0f;
+    for (unsigned int i = 1; i < kMaxValence; i++) {
+      valence[i] = 2.0f / std::sqrt((float)i);
+    }
+  }
+
+  float Score(int cache_position, unsigned int live_triangles) const {
+    if (live_triangles == 0) {
+      return -1.0f;
+    }
+    float score = cache_position < 0 ? 0.0f : cache[cache_position];
+    return score + valence[std::min(live_triangles, kMaxValence - 1)];
+  }
+};
+
+// Counts vertex shader invocations for a FIFO cache of cache_size entries. A vertex is resident
+// while fewer than cache_size misses have happened since it was last loaded.
+class FifoCache {
+public:
+  FifoCache(size_t vertex_count, unsigned int cache_size)
+      : timestamps_(vertex_count, 0), cache_size_(cache_size), time_(cache_size + 1) {}
+
+  bool Access(uint32_t vertex) {
+    if (time_ - timestamps_[vertex] > cache_size_) {
+      timestamps_[vertex] = time_++;
+      return true;
+    }
+    return false;
+  }
+
+  void Clear() { time_ += cache_size_ + 1; }
+
+private:
+  std::vector<unsigned int> timestamps_;
+  unsigned int cache_size_;
+  unsigned int time_;
+};
+
+unsigned int triangleMisses(FifoCache &cache, const uint32_t *triangle) {
+  return cache.Access(triangle[0]) + cache.Access(triangle[1]) + cache.Access(triangle[2]);
+}
+
+struct Cluster {
+  size_t begin;
+  size_t end;
+  float sort_key;
+};
+
+} // namespace
+
+size_t GenerateVertexRemap(const void *vertices, size_t vertex_count, size_t vertex_size,
+                           uint32_t *remap) {
+  const auto *bytes = static_cast<const unsigned char *>(vertices);
+
+  // Open addressing with linear probing, kept at most half full. Slots hold the input index of
+  // the first occurrence of each distinct vertex.
+  size_t table_size = 1;
+  while (table_size < vertex_count * 2) {
+    table_size *= 2;
+  }
+  std::vector<uint32_t> table(table_size, kEmptySlot);
+  size_t mask = table_size - 1;
+
+  size_t unique_count = 0;
+  for (size_t i = 0; i < vertex_count; i++) {
+    const unsigned char *vertex = bytes + i * vertex_size;
+    size_t slot = hashVertex(vertex, vertex_size) & mask;
+    while (table[slot] != kEmptySlot &&
+           std::memcmp(bytes + table[slot] * vertex_size, vertex, vertex_size) != 0) {
+      slot = (slot + 1) & mask;
+    }
+    if (table[slot] == kEmptySlot) {
+      table[slot] = (uint32_t)i;
+      remap[i] = (uint32_t)unique_count++;
+    } else {
+      remap[i] = remap[table[slot]];
+    }
+  }
+  return unique_count;
+}
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t *indices, size_t index_count,
+                                         size_t vertex_count, unsigned int cache_size) {
+  VertexCacheStatistics statistics;
+  FifoCache cache(vertex_count, cache_size);
+  for (size_t i = 0; i < index_count; i++) {
+    statistics.vertices_transformed += cache.Access(indices[i]);
+  }
+  if (index_count > 0) {
+    statistics.acmr = (float)statistics.vertices_transformed / (float)(index_count / 3);
+  }
+  if (vertex_count > 0) {
+    statistics.atvr = (float)statistics.vertices_transformed / (float)vertex_count;
+  }
+  return statistics;
+}
+
+void OptimizeVertexCache(uint32_t *destination, const uint32_t *indices, size_t index_count,
+                         size_t vertex_count) {
+  static const ForsythTables tables;
+  size_t triangle_count = index_count / 3;
+  if (triangle_count == 0) {
+    return;
+  }
+
+  // Triangles adjacent to each vertex, as ranges into adjacency. Emitted triangles are swapped to
+  // the end of their range and live_triangles shrinks accordingly.
+  std::vector<unsigned int> live_triangles(vertex_count, 0);
+  for (size_t i = 0; i < triangle_count * 3; i++) {
+    live_triangles[indices[i]]++;
+  }
+  std::vector<size_t> first_adjacent(vertex_count + 1, 0);
+  for (size_t v = 0; v < vertex_count; v++) {
+    first_adjacent[v + 1] = first_adjacent[v] + live_triangles[v];
+  }
+  std::vector<uint32_t> adjacency(triangle_count * 3);
+  {
+    std::vector<size_t> fill(first_adjacent.begin(), first_adjacent.end() - 1);
+    for (size_t i = 0; i < triangle_count * 3; i++) {
+      adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+  }
+
+  std::vector<float> vertex_score(vertex_count);
+  for (size_t v = 0; v < vertex_count; v++) {
+    vertex_score[v] = tables.Score(-1, live_triangles[v]);
+  }
+  std::vector<float> triangle_score(triangle_count);
+  for (size_t t = 0; t < triangle_count; t++) {
+    triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] +
+                        vertex_score[indices[t * 3 + 2]];
+  }
+  std::vector<bool> emitted(triangle_count, false);
+
+  // The output is built separately so that destination may alias indices.
+  std::vector<uint32_t> output(triangle_count * 3);
+  std::vector<uint32_t> cache, next_cache;
+  cache.reserve(kForsythCacheSize + 3);
+  next_cache.reserve(kForsythCacheSize + 3);
+
+  size_t input_cursor = 0;
+  size_t current = 0;
+  for (size_t emitted_count = 0; emitted_count < triangle_count; emitted_count++) {
+    if (current == triangle_count) {
+      // Nothing in the cache has triangles left; restart from the next unemitted one in input
+      // order.
+      while (emitted[input_cursor]) {
+        input_cursor++;
+      }
+      current = input_cursor;
+    }
+
+    const uint32_t *triangle = indices + current * 3;
+    std::copy(triangle, triangle + 3, output.begin() + emitted_count * 3);
+    emitted[current] = true;
+
+    next_cache.clear();
+    for (int corner = 0; corner < 3; corner++) {
+      uint32_t v = triangle[corner];
+      uint32_t *adjacent = adjacency.data() + first_adjacent[v];
+      uint32_t *last = adjacent + live_triangles[v] - 1;
+      *std::find(adjacent, last, (uint32_t)current) = *last;
+      live_triangles[v]--;
+      if (std::find(next_cache.begin(), next_cache.end(), v) == next_cache.end()) {
+        next_cache.push_back(v);
+      }
+    }
+    for (uint32_t v : cache) {
+      if (std::find(next_cache.begin(), next_cache.end(), v) == next_cache.end()) {
+        next_cache.push_back(v);
+      }
+    }
+
+    // Rescore every vertex whose cache position changed, including those that just fell out,
+    // then pick the best triangle among those still in the cache.
+    for (size_t i = 0; i < next_cache.size(); i++) {
+      uint32_t v = next_cache[i];
+      float score = tables.Score(i < kForsythCacheSize ? (int)i : -1, live_triangles[v]);
+      float delta = score - vertex_score[v];
+      vertex_score[v] = score;
+      const uint32_t *adjacent = adjacency.data() + first_adjacent[v];
+      for (unsigned int j = 0; j < live_triangles[v]; j++) {
+        triangle_score[adjacent[j]] += delta;
+      }
+    }
+    float best_score = -1.0f;
+    current = triangle_count;
+    for (size_t i = 0; i < next_cache.size() && i < kForsythCacheSize; i++) {
+      uint32_t v = next_cache[i];
+      const uint32_t *adjacent = adjacency.data() + first_adjacent[v];
+      for (unsigned int j = 0; j < live_triangles[v]; j++) {
+        if (triangle_score[adjacent[j]] > best_score) {
+          best_score = triangle_score[adjacent[j]];
+          current = adjacent[j];
+        }
+      }
+    }
+    if (next_cache.size() > kForsythCacheSize) {
+      next_cache.resize(kForsythCacheSize);
+    }
+    std::swap(cache, next_cache);
+  }
+
+  std::copy(output.begin(), output.end(), destination);
+}
+
+void OptimizeOverdraw(uint32_t *destination, const uint32_t *indices, size_t index_count,
+                      const float *positions, size_t vertex_count, size_t position_stride,
+                      float threshold) {
+  constexpr unsigned int kCacheSize = 16;
+  size_t triangle_count = index_count / 3;
+  const auto *position_bytes = reinterpret_cast<const unsigned char *>(positions);
+  auto position = [&](uint32_t v) {
+    const auto *p = reinterpret_cast<const float *>(position_bytes + v * position_stride);
+    return std::array<float, 3>{p[0], p[1], p[2]};
+  };
+
+  if (triangle_count == 0) {
+    return;
+  }
+
+  // Hard boundaries are where the cache-optimized order already restarts with three misses, so
+  // cutting there costs nothing. The first cluster always starts at triangle 0, even when that
+  // triangle is degenerate and misses fewer than three times.
+  std::vector<size_t> hard_boundaries = {0};
+  FifoCache cache(vertex_count, kCacheSize);
+  for (size_t t = 0; t < triangle_count; t++) {
+    if (triangleMisses(cache, indices + t * 3) == 3 && t > 0) {
+      hard_boundaries.push_back(t);
+    }
+  }
+  hard_boundaries.push_back(triangle_count);
+
+  // Within each hard cluster, split further whenever the ACMR so far, with the cache flushed at
+  // the last split, stays within threshold of the cluster's own ACMR.
+  std::vector<Cluster> clusters;
+  for (size_t h = 0; h + 1 < hard_boundaries.size(); h++) {
+    size_t begin = hard_boundaries[h];
+    size_t end = hard_boundaries[h + 1];
+
+    cache.Clear();
+    unsigned int cluster_misses = 0;
+    for (size_t t = begin; t < end; t++) {
+      cluster_misses += triangleMisses(cache, indices + t * 3);
+    }
+    float limit = threshold * (float)cluster_misses / (float)(end - begin);
+
+    cache.Clear();
+    size_t start = begin;
+    unsigned int misses = 0;
+    for (size_t t = begin; t < end; t++) {
+      misses += triangleMisses(cache, indices + t * 3);
+      if (t + 1 < end && (float)misses / (float)(t + 1 - start) <= limit) {
+        clusters.push_back({start, t + 1, 0.0f});
+        start = t + 1;
+        misses = 0;
+        cache.Clear();
+      }
+    }
+    clusters.push_back({start, end, 0.0f});
+  }
+
+  // Sort key: how far the cluster's area-weighted centroid lies in front of the mesh centroid
+  // along the cluster's average normal.
+  float mesh_area = 0.0f;
+  std::array<float, 3> mesh_centroid = {0.0f, 0.0f, 0.0f};
+  std::vector<std::array<float, 7>> cluster_sums(clusters.size());
+  for (size_t c = 0; c < clusters.size(); c++) {
+    std::array<float, 7> &sum = cluster_sums[c];
+    sum.fill(0.0f);
+    for (size_t t = clusters[c].begin; t < clusters[c].end; t++) {
+      std::array<float, 3> a = position(indices[t * 3]);
+      std::array<float, 3> b = position(indices[t * 3 + 1]);
+      std::array<float, 3> p = position(indices[t * 3 + 2]);
+      float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+      float e2[3] = {p[0] - a[0], p[1] - a[1], p[2] - a[2]};
+      float normal[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2],
+                         e1[0] * e2[1] - e1[1] * e2[0]};
+      float area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] +
+                             normal[2] * normal[2]);
+      for (int k = 0; k < 3; k++) {
+        sum[k] += (a[k] + b[k] + p[k]) / 3.0f * area;
+        sum[3 + k] += normal[k];
+      }
+      sum[6] += area;
+    }
+    for (int k = 0; k < 3; k++) {
+      mesh_centroid[k] += sum[k];
+    }
+    mesh_area += sum[6];
+  }
+  if (mesh_area > 0.0f) {
+    for (float &coordinate : mesh_centroid) {
+      coordinate /= mesh_area;
+    }
+  }
+  for (size_t c = 0; c < clusters.size(); c++) {
+    const std::array<float, 7> &sum = cluster_sums[c];
+    float length = std::sqrt(sum[3] * sum[3] + sum[4] * sum[4] + sum[5] * sum[5]);
+    if (sum[6] <= 0.0f || length <= 0.0f) {
+      continue;
+    }
+    float key = 0.0f;
+    for (int k = 0; k < 3; k++) {
+      key += (sum[k] / sum[6] - mesh_centroid[k]) * sum[3 + k] / length;
+    }
+    clusters[c].sort_key = key;
+  }
+
+  std::stable_sort(clusters.begin(), clusters.end(),
+                   [](const Cluster &a, const Cluster &b) { return a.sort_key > b.sort_key; });
+  for (const Cluster &cluster : clusters) {
+    destination = std::copy(indices + cluster.begin * 3, indices + cluster.end * 3, destination);
+  }
+}
+
+size_t OptimizeVertexFetchRemap(uint32_t *remap, uint32_t *indices, size_t index_count,
+                                size_t vertex_count) {
+  std::fill(remap, remap + vertex_count, ~0u);
+  uint32_t next = 0;
+  for (size_t i = 0; i < index_count; i++) {
+    uint32_t &slot = remap[indices[i]];
+    if (slot == ~0u) {
+      slot = next++;
+    }
+    indices[i] = slot;
+  }
+  return next;
+}
+
+IndexData PackIndices(const uint32_t *indices, size_t index_count, size_t vertex_count) {
+  IndexData data;
+  data.count = index_count;
+  if (vertex_count <= (size_t)std::numeric_limits<uint16_t>::max() + 1) {
+    data.type = GL_UNSIGNED_SHORT;
+    data.bytes.resize(index_count * sizeof(uint16_t));
+    auto *out = reinterpret_cast<uint16_t *>(data.bytes.data());
+    for (size_t i = 0; i < index_count; i++) {
+      out[i] = (uint16_t)indices[i];
+    }
+  } else {
+    data.type = GL_UNSIGNED_INT;
+    data.bytes.resize(index_count * sizeof(uint32_t));
+    std::memcpy(data.bytes.data(), indices, data.bytes.size());
+  }
+  return data;
+}
@@ -0,0 +1,118 @@
+#ifndef LEARNOPENGL_MESH_PROCESSING_H
+#define LEARNOPENGL_MESH_PROCESSING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "mesh.h"
+
+template <typename Vertex>
+struct IndexedMesh {
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+};
+
+/**
+ * Finds vertices that are bitwise identical to an earlier one, so any padding in the vertex must
+ * be zeroed. Writes the welded index of every input vertex to remap, numbering unique vertices in
+ * order of first appearance, and returns how many there are.
+ */
+size_t GenerateVertexRemap(const void *vertices, size_t vertex_count, size_t vertex_size,
+                           uint32_t *remap);
+
+/** Turns a triangle soup into unique vertices plus an index buffer that references them. */
+template <typename Vertex>
+IndexedMesh<Vertex> WeldVertices(const Vertex *vertices, size_t vertex_count) {
+  IndexedMesh<Vertex> mesh;
+  mesh.indices.resize(vertex_count);
+  size_t unique_count =
+      GenerateVertexRemap(vertices, vertex_count, sizeof(Vertex), mesh.indices.data());
+  mesh.vertices.resize(unique_count);
+  for (size_t i = 0; i < vertex_count; i++) {
+    mesh.vertices[mesh.indices[i]] = vertices[i];
+  }
+  return mesh;
+}
+
+/**
+ * How well an index buffer reuses transformed vertices under a FIFO post-transform cache. ACMR is
+ * vertex shader invocations per triangle (0.5 at best for a large regular grid, 3 at worst), ATVR
+ * is invocations per vertex (1 at best).
+ */
+struct VertexCacheStatistics {
+  size_t vertices_transformed = 0;
+  float acmr = 0.0f;
+  float atvr = 0.0f;
+};
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t *indices, size_t index_count,
+                                         size_t vertex_count, unsigned int cache_size = 16);
+
+/**
+ * Reorders triangles so that consecutive ones share vertices, using Forsyth's linear-speed vertex
+ * cache optimization. It does not assume a particular hardware cache size. destination may alias
+ * indices.
+ */
+void OptimizeVertexCache(uint32_t *destination, const uint32_t *indices, size_t index_count,
+                         size_t vertex_count);
+
+/**
+ * Reorders clusters of a cache-optimized index buffer so that triangles facing away from the mesh
+ * center, which tend to occlude the rest, are drawn first (Sander et al., "Fast Triangle
+ * Reordering for Vertex Locality and Reduced Overdraw"). Clusters are split only where this costs
+ * at most a factor of threshold in ACMR. destination must not alias indices.
+ */
+void OptimizeOverdraw(uint32_t *destination, const uint32_t *indices, size_t index_count,
+                      const float *positions, size_t vertex_count, size_t position_stride,
+                      float threshold = 1.05f);
+
+/**
+ * Numbers vertices in the order the index buffer first uses them, rewriting indices in place, so
+ * that vertex fetches walk memory linearly. Writes the new index of each vertex to remap (~0u for
+ * unused ones) and returns the number of used vertices.
+ */
+size_t OptimizeVertexFetchRemap(uint32_t *remap, uint32_t *indices, size_t index_count,
+                                size_t vertex_count);
+
+template <typename Vertex>
+void OptimizeVertexFetch(IndexedMesh<Vertex> &mesh) {
+  std::vector<uint32_t> remap(mesh.vertices.size());
+  size_t used_count = OptimizeVertexFetchRemap(remap.data(), mesh.indices.data(),
+                                               mesh.indices.size(), mesh.vertices.size());
+  std::vector<Vertex> vertices(used_count);
+  for (size_t i = 0; i < mesh.vertices.size(); i++) {
+    if (remap[i] != ~0u) {
+      vertices[remap[i]] = mesh.vertices[i];
+    }
+  }
+  mesh.vertices = std::move(vertices);
+}
+
+/**
+ * Runs the vertex cache, overdraw and vertex fetch passes in that order. Vertex needs a glm::vec3
+ * position member. Returns the cache statistics of the result.
+ */
+template <typename Vertex>
+VertexCacheStatistics OptimizeMesh(IndexedMesh<Vertex> &mesh, float overdraw_threshold = 1.05f) {
+  OptimizeVertexCache(mesh.indices.data(), mesh.indices.data(), mesh.indices.size(),
+                      mesh.vertices.size());
+  if (!mesh.vertices.empty()) {
+    std::vector<uint32_t> cache_ordered = mesh.indices;
+    OptimizeOverdraw(mesh.indices.data(), cache_ordered.data(), cache_ordered.size(),
+                     &mesh.vertices[0].position.x, mesh.vertices.size(), sizeof(Vertex),
+                     overdraw_threshold);
+  }
+  OptimizeVertexFetch(mesh);
+  return AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+}
+
+/** Stores indices as 16-bit values when every vertex is addressable that way, 32-bit otherwise. */
+IndexData PackIndices(const uint32_t *indices, size_t index_count, size_t vertex_count);
+
+inline IndexData PackIndices(const std::vector<uint32_t> &indices, size_t vertex_count) {
+  return PackIndices(indices.data(), indices.size(), vertex_count);
+}
+
+#endif // LEARNOPENGL_MESH_PROCESSING_H
@@ -0,0 +1,256 @@
+#include "meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+glm::vec3 positionAt(const float *positions, size_t stride, uint32_t index) {
+  glm::vec3 p;
+  std::memcpy(&p, reinterpret_cast<const unsigned char *>(positions) + index * stride, sizeof(p));
+  return p;
+}
+
+// Ritter's bounding sphere over the given vertices.
+void computeSphere(const std::vector<glm::vec3> &points, glm::vec3 &center, float &radius) {
+  auto farthest = [&](const glm::vec3 &from) {
+    const glm::vec3 *best = &points[0];
+    for (const glm::vec3 &p : points) {
+      if (glm::dot(p - from, p - from) > glm::dot(*best - from, *best - from)) {
+        best = &p;
+      }
+    }
+    return *best;
+  };
+  glm::vec3 a = farthest(points[0]);
+  glm::vec3 b = farthest(a);
+  center = (a + b) * 0.5f;
+  radius = glm::length(b - a) * 0.5f;
+  for (const glm::vec3 &p : points) {
+    float distance = glm::length(p - center);
+    if (distance > radius) {
+      float grown = (radius + distance) * 0.5f;
+      center += (p - center) * ((grown - radius) / distance);
+      radius = grown;
+    }
+  }
+}
+
+void computeBounds(Meshlet &meshlet, const uint32_t *indices, const float *positions,
+                   size_t stride, std::vector<glm::vec3> &points) {
+  points.clear();
+  glm::vec3 normal_sum(0.0f);
+  std::vector<glm::vec3> normals;
+  for (uint32_t i = 0; i < meshlet.range.count; i += 3) {
+    const uint32_t *t = &indices[meshlet.range.first + i];
+    glm::vec3 a = positionAt(positions, stride, t[0]), b = positionAt(positions, stride, t[1]),
+              c = positionAt(positions, stride, t[2]);
+    points.push_back(a);
+    points.push_back(b);
+    points.push_back(c);
+    glm::vec3 normal = glm::cross(b - a, c - a);
+    float length = glm::length(normal);
+    if (length > 0.0f) {
+      normals.push_back(normal / length);
+      normal_sum += normals.back();
+    }
+  }
+  computeSphere(points, meshlet.center, meshlet.radius);
+
+  meshlet.cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+  meshlet.cone_cutoff = 1.0f;
+  float axis_length = glm::length(normal_sum);
+  if (axis_length <= 0.0f) {
+    return;
+  }
+  meshlet.cone_axis = normal_sum / axis_length;
+  float min_dot = 1.0f;
+  for (const glm::vec3 &normal : normals) {
+    min_dot = std::min(min_dot, glm::dot(normal, meshlet.cone_axis));
+  }
+  // Cones wider than about 84 degrees would almost never cull, and lose precision as they widen.
+  if (min_dot > 0.1f) {
+    meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+  }
+}
+
+} // namespace
+
+std::vector<Meshlet> BuildMeshlets(uint32_t *indices, size_t index_count, const float *positions,
+                                   size_t vertex_count, size_t position_stride,
+                                   size_t max_vertices, size_t max_triangles) {
+  size_t triangle_count = index_count / 3;
+  std::vector<Meshlet> meshlets;
+  if (triangle_count == 0 || max_vertices < 3 || max_triangles < 1) {
+    return meshlets;
+  }
+
+  // Triangles around each vertex.
+  std::vector<uint32_t> first_adjacent(vertex_count + 1, 0);
+  for (size_t i = 0; i < triangle_count * 3; i++) {
+    first_adjacent[indices[i] + 1]++;
+  }
+  for (size_t v = 0; v < vertex_count; v++) {
+    first_adjacent[v + 1] += first_adjacent[v];
+  }
+  std::vector<uint32_t> adjacency(triangle_count * 3);
+  {
+    std::vector<uint32_t> fill(first_adjacent.begin(), first_adjacent.end() - 1);
+    for (size_t i = 0; i < triangle_count * 3; i++) {
+      adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+  }
+
+  std::vector<glm::vec3> centroids(triangle_count);
+  for (size_t t = 0; t < triangle_count; t++) {
+    centroids[t] = (positionAt(positions, position_stride, indices[t * 3]) +
+                    positionAt(positions, position_stride, indices[t * 3 + 1]) +
+                    positionAt(positions, position_stride, indices[t * 3 + 2])) /
+                   3.0f;
+  }
+
+  // Stamps record membership without clearing per meshlet: a vertex is in the current meshlet if
+  // its stamp equals the meshlet's, and likewise a triangle is already a candidate.
+  std::vector<uint32_t> vertex_stamp(vertex_count, 0);
+  std::vector<uint32_t> candidate_stamp(triangle_count, 0);
+  std::vector<bool> emitted(triangle_count, false);
+  std::vector<uint32_t> order;
+  order.reserve(triangle_count);
+  std::vector<uint32_t> candidates;
+  size_t seed = 0;
+  uint32_t stamp = 0;
+
+  while (order.size() < triangle_count) {
+    while (emitted[seed]) {
+      seed++;
+    }
+    stamp++;
+    Meshlet meshlet = {{(uint32_t)order.size() * 3, 0}, 0, {}, 0.0f, {}, 1.0f};
+    glm::vec3 centroid_sum(0.0f);
+    size_t triangles = 0;
+    candidates.clear();
+
+    uint32_t next = (uint32_t)seed;
+    while (true) {
+      emitted[next] = true;
+      order.push_back(next);
+      triangles++;
+      centroid_sum += centroids[next];
+      for (int k = 0; k < 3; k++) {
+        uint32_t v = indices[next * 3 + k];
+        if (vertex_stamp[v] == stamp) {
+          continue;
+        }
+        vertex_stamp[v] = stamp;
+        meshlet.vertex_count++;
+        for (uint32_t j = first_adjacent[v]; j < first_adjacent[v + 1]; j++) {
+          uint32_t t = adjacency[j];
+          if (!emitted[t] && candidate_stamp[t] != stamp) {
+            candidate_stamp[t] = stamp;
+            candidates.push_back(t);
+          }
+        }
+      }
+      if (triangles == max_triangles) {
+        break;
+      }
+
+      // Prefer neighbours that add the fewest vertices, then those nearest the meshlet's middle,
+      // which keeps meshlets round and their bounds tight.
+      glm::vec3 middle = centroid_sum / (float)triangles;
+      uint32_t best = std::numeric_limits<uint32_t>::max();
+      size_t best_new = 3;
+      float best_distance = std::numeric_limits<float>::max();
+      for (size_t c = 0; c < candidates.size();) {
+        uint32_t t = candidates[c];
+        if (emitted[t]) {
+          candidates[c] = candidates.back();
+          candidates.pop_back();
+          continue;
+        }
+        size_t added = 0;
+        for (int k = 0; k < 3; k++) {
+          added += vertex_stamp[indices[t * 3 + k]] != stamp;
+        }
+        glm::vec3 offset = centroids[t] - middle;
+        float distance = glm::dot(offset, offset);
+        if (meshlet.vertex_count + added <= max_vertices &&
+            (added < best_new || (added == best_new && distance < best_distance))) {
+          best = t;
+          best_new = added;
+          best_distance = distance;
+        }
+        c++;
+      }
+      if (best == std::numeric_limits<uint32_t>::max()) {
+        break;
+      }
+      next = best;
+    }
+    meshlet.range.count = (uint32_t)triangles * 3;
+    meshlets.push_back(meshlet);
+  }
+
+  std::vector<uint32_t> reordered(triangle_count * 3);
+  for (size_t i = 0; i < triangle_count; i++) {
+    std::copy(indices + order[i] * 3, indices + order[i] * 3 + 3, &reordered[i * 3]);
+  }
+  std::copy(reordered.begin(), reordered.end(), indices);
+
+  std::vector<glm::vec3> points;
+  for (Meshlet &meshlet : meshlets) {
+    computeBounds(meshlet, indices, positions, position_stride, points);
+  }
+  return meshlets;
+}
+
+SphereBounds MeshletSpheres(const std::vector<Meshlet> &meshlets) {
+  SphereBounds spheres;
+  for (const Meshlet &meshlet : meshlets) {
+    spheres.Add(meshlet.center, meshlet.radius);
+  }
+  return spheres;
+}
+
+size_t CullMeshlets(const std::vector<Meshlet> &meshlets, const SphereBounds &spheres,
+                    const glm::mat4 &model, const glm::mat4 &view_projection,
+                    const glm::vec3 &camera_position, std::vector<IndexRange> &visible) {
+  // The frustum is brought into model space rather than every sphere into world space, so the
+  // spheres are tested as they are, many at a time. Scaling is uniform, so distances to the planes
+  // and radii scale alike. Callers cull several models at once, so this stays on their thread.
+  thread_local std::vector<uint8_t> in_frustum;
+  in_frustum.resize(meshlets.size());
+  if (CullSpheres(Frustum(view_projection * model), spheres, in_frustum.data(), 1) == 0) {
+    return 0;
+  }
+  glm::mat3 rotation_scale(model);
+  float scale = glm::length(rotation_scale[0]);
+  size_t merge_from = visible.size();
+  size_t visible_count = 0;
+  for (size_t i = 0; i < meshlets.size(); i++) {
+    const Meshlet &meshlet = meshlets[i];
+    if (!in_frustum[i]) {
+      continue;
+    }
+    // Culled if the camera looks at the whole sphere from within the cone's backface region.
+    if (meshlet.cone_cutoff < 1.0f) {
+      glm::vec3 center = glm::vec3(model * glm::vec4(meshlet.center, 1.0f));
+      float radius = meshlet.radius * scale;
+      glm::vec3 axis = rotation_scale * meshlet.cone_axis / scale;
+      glm::vec3 view = center - camera_position;
+      if (glm::dot(view, axis) >= meshlet.cone_cutoff * glm::length(view) + radius) {
+        continue;
+      }
+    }
+    visible_count++;
+    if (visible.size() > merge_from &&
+        visible.back().first + visible.back().count == meshlet.range.first) {
+      visible.back().count += meshlet.range.count;
+    } else {
+      visible.push_back(meshlet.range);
+    }
+  }
+  return visible_count;
+}
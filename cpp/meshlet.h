@@ -0,0 +1,69 @@
+#ifndef LEARNOPENGL_MESHLET_H
+#define LEARNOPENGL_MESHLET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "frustum.h"
+#include "frustum_culling.h"
+#include "mesh.h"
+#include "mesh_processing.h"
+
+// Limits that keep a meshlet's vertices and triangles within what a GPU processes together.
+constexpr size_t kMaxMeshletVertices = 64;
+constexpr size_t kMaxMeshletTriangles = 124;
+
+/**
+ * A small cluster of neighbouring triangles: a range of its mesh's indices, with bounds for
+ * culling it on its own. Every triangle faces away from any viewer inside the normal cone's
+ * backface region, so the cluster is culled from there; see CullMeshlets.
+ */
+struct Meshlet {
+  IndexRange range;
+  uint32_t vertex_count;
+  glm::vec3 center;
+  float radius;
+  // Average triangle normal, and the sine of the largest angle between it and any triangle's
+  // normal. A cutoff of 1 or more means the triangles face too many ways to ever be culled.
+  glm::vec3 cone_axis;
+  float cone_cutoff;
+};
+
+/**
+ * Reorders the triangles of indices into meshlets of at most max_vertices distinct vertices and
+ * max_triangles triangles, grown greedily from each seed towards the neighbours that add the
+ * fewest vertices. Keeps the original order as far as it can, so run OptimizeMesh first.
+ */
+std::vector<Meshlet> BuildMeshlets(uint32_t *indices, size_t index_count, const float *positions,
+                                   size_t vertex_count, size_t position_stride,
+                                   size_t max_vertices = kMaxMeshletVertices,
+                                   size_t max_triangles = kMaxMeshletTriangles);
+
+/** As above, for a Vertex with a glm::vec3 position member. */
+template <typename Vertex>
+std::vector<Meshlet> BuildMeshlets(IndexedMesh<Vertex> &mesh,
+                                   size_t max_vertices = kMaxMeshletVertices,
+                                   size_t max_triangles = kMaxMeshletTriangles) {
+  if (mesh.vertices.empty()) {
+    return {};
+  }
+  return BuildMeshlets(mesh.indices.data(), mesh.indices.size(), &mesh.vertices[0].position.x,
+                       mesh.vertices.size(), sizeof(Vertex), max_vertices, max_triangles);
+}
+
+/** The meshlets' bounding spheres, in model space, laid out for CullMeshlets. */
+SphereBounds MeshletSpheres(const std::vector<Meshlet> &meshlets);
+
+/**
+ * Appends to visible the index ranges of the meshlets that may be seen by a camera at
+ * camera_position through view_projection, when drawn with model, which may rotate, translate and
+ * scale uniformly. spheres are MeshletSpheres(meshlets). Meshlets that are adjacent in the index
+ * buffer are merged into one range. Returns the number of visible meshlets.
+ */
+size_t CullMeshlets(const std::vector<Meshlet> &meshlets, const SphereBounds &spheres,
+                    const glm::mat4 &model, const glm::mat4 &view_projection,
+                    const glm::vec3 &camera_position, std::vector<IndexRange> &visible);
+
+#endif // LEARNOPENGL_MESHLET_H
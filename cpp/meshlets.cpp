@@ -0,0 +1,167 @@
+#include <cstdlib>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <string_view>
+
+#include "camera.h"
+#include "command_buffer.h"
+#include "common.h"
+#include "mesh.h"
+#include "mesh_file.h"
+#include "mesh_lod.h"
+#include "mesh_processing.h"
+#include "meshlet.h"
+#include "ring_buffer.h"
+#include "shader.h"
+#include "texture_loader.h"
+
+// The Frame uniform block of vertex_shader.glsl, in std140 layout.
+struct FrameUniforms {
+  glm::mat4 view;
+  glm::mat4 projection;
+};
+
+// Draws a grid of copies of one large OBJ mesh, culling each copy per meshlet against the view
+// frustum and by facing. The copies are animated, culled and recorded on every core, and only the
+// recorded GL calls run on the GL thread.
+//
+//   meshlets [--headless] [--frames=N] [model.obj]
+int main(int argc, char **argv) {
+  const char *path = "/Users/kal/Code/learnopengl/model.obj";
+  for (int i = 1; i < argc; i++) {
+    if (std::string_view(argv[i]).substr(0, 2) != "--") {
+      path = argv[i];
+    }
+  }
+
+  auto app = GlfwApplication::Create(GlfwApplication::ParseOptions(argc, argv));
+
+  Shader shader("/Users/kal/Code/learnopengl/vertex_shader.glsl",
+                "/Users/kal/Code/learnopengl/fragment_shader.glsl", Shader::kAsync);
+  TextureLoader loader(/*threads=*/0, /*compress=*/true);
+  unsigned int texture1 = loader.Load("/Users/kal/Code/learnopengl/container.jpeg");
+  unsigned int texture2 =
+      loader.Load("/Users/kal/Code/learnopengl/awesomeface.png", /*flip_vertically=*/true);
+
+  // Parsed and optimized once, then read back from the cooked .mesh next to the OBJ.
+  std::optional<IndexedMesh<MeshVertex>> model = LoadObjCachedMesh(path);
+  if (!model) {
+    return EXIT_FAILURE;
+  }
+  // Meshlets reorder the triangles, so they are built before the indices are uploaded.
+  std::vector<Meshlet> meshlets = BuildMeshlets(*model);
+  SphereBounds meshlet_spheres = MeshletSpheres(meshlets);
+  if (app->Stats()) {
+    std::cout << model->indices.size() / 3 << " triangles in " << meshlets.size() << " meshlets"
+              << std::endl;
+  }
+  Mesh<MeshVertex> mesh(model->vertices, PackIndices(model->indices, model->vertices.size()));
+
+  // The first copy sits where a single one would, the rest in rows behind it.
+  constexpr size_t kGridSize = 4;
+  constexpr size_t kCopies = kGridSize * kGridSize;
+  BoundingSphere bounds = ComputeBoundingSphere(&model->vertices[0].position.x,
+                                                model->vertices.size(), sizeof(MeshVertex));
+  float spacing = 2.5f * bounds.radius;
+  ParallelRecorder recorder;
+
+  glEnable(GL_DEPTH_TEST);
+  // The cone test only rejects whole meshlets; the back faces left in the ones it keeps are
+  // culled per triangle.
+  glEnable(GL_CULL_FACE);
+
+  float delta_time = 0.0f;
+  float last_frame = 0.0f;
+  Camera camera(glm::vec3(0.0, 0.0, 3.0f));
+  app->OnKey(GLFW_KEY_W, [&]() { camera.ProcessKeyboard(FORWARD, delta_time); });
+  app->OnKey(GLFW_KEY_S, [&]() { camera.ProcessKeyboard(BACKWARD, delta_time); });
+  app->OnKey(GLFW_KEY_A, [&]() { camera.ProcessKeyboard(LEFT, delta_time); });
+  app->OnKey(GLFW_KEY_D, [&]() { camera.ProcessKeyboard(RIGHT, delta_time); });
+
+  app->DisableCursor();
+  float last_x = 400, last_y = 300;
+  bool first_mouse = true;
+  app->OnMouse([&](double x, double y) {
+    if (first_mouse) {
+      last_x = x;
+      last_y = y;
+      first_mouse = false;
+    }
+    camera.ProcessMouseMovement(x - last_x, y - last_y);
+    last_x = x;
+    last_y = y;
+  });
+  app->OnScroll([&]([[maybe_unused]] double x, double y) { camera.ProcessMouseScroll(y); });
+
+  Shader::Uniform texture1_uniform = shader.uniform("texture1");
+  Shader::Uniform texture2_uniform = shader.uniform("texture2");
+  shader.bindUniformBlock("Frame", 0);
+
+  RingBuffer ring(sizeof(FrameUniforms) + kCopies * sizeof(glm::mat4));
+  app->Run([&]() {
+    loader.Update();
+
+    float current_frame = glfwGetTime();
+    delta_time = current_frame - last_frame;
+    last_frame = current_frame;
+
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture1);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, texture2);
+
+    shader.use();
+    shader.setInt(texture1_uniform, 0);
+    shader.setInt(texture2_uniform, 1);
+    glm::mat4 projection =
+        glm::perspective(glm::radians(camera.Zoom()), 800.0f / 600.0f, 0.1f, 100.0f);
+    glm::mat4 view = camera.ViewMatrix();
+    ring.BeginFrame();
+    RingBuffer::Allocation frame = ring.Allocate(sizeof(FrameUniforms), ring.UniformAlignment());
+    RingBuffer::Allocation models = ring.Allocate(kCopies * sizeof(glm::mat4));
+    if (frame.data == nullptr || models.data == nullptr) {
+      // Allocate has reported it; drawing without the frame's data would read stale matrices.
+      ring.EndFrame();
+      return;
+    }
+    FrameUniforms uniforms = {view, projection};
+    std::memcpy(frame.data, &uniforms, sizeof(uniforms));
+    glBindBufferRange(GL_UNIFORM_BUFFER, 0, ring.Buffer(), frame.offset, sizeof(uniforms));
+
+    // Each copy's model matrix goes straight into the ring buffer, and only the meshlets that can
+    // contribute pixels are drawn, in as few ranges as possible.
+    glm::mat4 view_projection = projection * view;
+    recorder.Record(kCopies, [&](CommandBuffer &buffer, size_t first, size_t last) {
+      thread_local std::vector<IndexRange> visible;
+      for (size_t i = first; i < last; i++) {
+        glm::vec3 position((float)(i % kGridSize) - (kGridSize - 1) * 0.5f, 0.0f,
+                           -(float)(i / kGridSize));
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), position * spacing);
+        transform = glm::rotate(transform, current_frame * 0.2f + (float)i,
+                                glm::vec3(0.0f, 1.0f, 0.0f));
+        static_cast<glm::mat4 *>(models.data)[i] = transform;
+
+        visible.clear();
+        CullMeshlets(meshlets, meshlet_spheres, transform, view_projection, camera.Position(),
+                     visible);
+        if (!visible.empty()) {
+          buffer.AttachInstances(mesh.Vao(), ring.Buffer(), models.offset + i * sizeof(glm::mat4));
+          buffer.MultiDrawElements(GL_TRIANGLES, mesh.IndexType(), visible.data(), visible.size());
+        }
+      }
+    });
+    ring.Flush();
+    recorder.Execute();
+    ring.EndFrame();
+
+    glBindVertexArray(0);
+  });
+
+  glDeleteTextures(1, &texture1);
+  glDeleteTextures(1, &texture2);
+}
@@ -0,0 +1,207 @@
+#include "offset_allocator.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr uint32_t kMantissaBits = 3;
+constexpr uint32_t kMantissaValue = 1 << kMantissaBits;
+constexpr uint32_t kMantissaMask = kMantissaValue - 1;
+
+uint32_t lowestSetBit(uint32_t bits) { return __builtin_ctz(bits); }
+uint32_t highestSetBit(uint32_t bits) { return 31 - __builtin_clz(bits); }
+
+// The lowest set bit at or above start, or OffsetAllocator::kNoSpace if there is none.
+uint32_t lowestSetBitFrom(uint32_t bits, uint32_t start) {
+  if (start >= 32) {
+    return OffsetAllocator::kNoSpace;
+  }
+  uint32_t masked = bits & ~((1u << start) - 1);
+  return masked == 0 ? OffsetAllocator::kNoSpace : lowestSetBit(masked);
+}
+
+// Bins are sizes in a tiny float format: below kMantissaValue the bin is the size itself, above it
+// the exponent and the kMantissaBits bits after the leading one. A bin's smallest size is
+// binSize(bin). Allocations round up, so that any range in the bin fits them; free ranges round
+// down, so that they fit anything asking for their bin.
+uint32_t binRoundingUp(uint32_t size) {
+  if (size < kMantissaValue) {
+    return size;
+  }
+  uint32_t mantissa_start = highestSetBit(size) - kMantissaBits;
+  uint32_t exponent = mantissa_start + 1;
+  uint32_t mantissa = (size >> mantissa_start) & kMantissaMask;
+  if ((size & ((1u << mantissa_start) - 1)) != 0) {
+    // Overflowing the mantissa carries into the exponent, which is the next bin up either way.
+    mantissa++;
+  }
+  return (exponent << kMantissaBits) + mantissa;
+}
+
+uint32_t binRoundingDown(uint32_t size) {
+  if (size < kMantissaValue) {
+    return size;
+  }
+  uint32_t mantissa_start = highestSetBit(size) - kMantissaBits;
+  uint32_t exponent = mantissa_start + 1;
+  uint32_t mantissa = (size >> mantissa_start) & kMantissaMask;
+  return (exponent << kMantissaBits) | mantissa;
+}
+
+uint32_t binSize(uint32_t bin) {
+  uint32_t exponent = bin >> kMantissaBits;
+  uint32_t mantissa = bin & kMantissaMask;
+  return exponent == 0 ? mantissa : (mantissa | kMantissaValue) << (exponent - 1);
+}
+
+} // namespace
+
+OffsetAllocator::OffsetAllocator(uint32_t size, uint32_t max_allocations)
+    : size_(size), nodes_(max_allocations) {
+  std::fill(bin_heads_, bin_heads_ + kBins, kNoSpace);
+  unused_nodes_.resize(max_allocations);
+  for (uint32_t i = 0; i < max_allocations; i++) {
+    // Popped from the back, so node 0 is used first.
+    unused_nodes_[i] = max_allocations - i - 1;
+  }
+  if (size > 0 && max_allocations > 0) {
+    InsertFreeNode(0, size);
+  }
+}
+
+OffsetAllocator::Allocation OffsetAllocator::Allocate(uint32_t size) {
+  // Splitting a range needs a spare node for the remainder.
+  if (size == 0 || unused_nodes_.empty()) {
+    return {};
+  }
+
+  uint32_t min_bin = binRoundingUp(size);
+  uint32_t top = min_bin / kLeafBinsPerTop;
+  uint32_t leaf = kNoSpace;
+  if (top < kTopBins && (top_bins_used_ & (1u << top)) != 0) {
+    leaf = lowestSetBitFrom(leaf_bins_used_[top], min_bin % kLeafBinsPerTop);
+  }
+  if (leaf == kNoSpace) {
+    // Every bin of any larger top bin fits.
+    top = lowestSetBitFrom(top_bins_used_, top + 1);
+    if (top == kNoSpace) {
+      return {};
+    }
+    leaf = lowestSetBit(leaf_bins_used_[top]);
+  }
+
+  uint32_t node = bin_heads_[top * kLeafBinsPerTop + leaf];
+  RemoveFreeNode(node);
+  Node &allocated = nodes_[node];
+  uint32_t remainder = allocated.size - size;
+  allocated.size = size;
+  allocated.used = true;
+
+  if (remainder > 0) {
+    uint32_t rest = InsertFreeNode(allocated.offset + size, remainder);
+    nodes_[rest].neighbor_previous = node;
+    nodes_[rest].neighbor_next = allocated.neighbor_next;
+    if (allocated.neighbor_next != kNoSpace) {
+      nodes_[allocated.neighbor_next].neighbor_previous = rest;
+    }
+    allocated.neighbor_next = rest;
+  }
+  return {allocated.offset, node};
+}
+
+void OffsetAllocator::Free(Allocation allocation) {
+  if (allocation.node == kNoSpace) {
+    return;
+  }
+  uint32_t node = allocation.node;
+  uint32_t offset = nodes_[node].offset;
+  uint32_t size = nodes_[node].size;
+
+  // Merge with free neighbours, whose nodes go back to the unused pool along with this one.
+  uint32_t previous = nodes_[node].neighbor_previous;
+  if (previous != kNoSpace && !nodes_[previous].used) {
+    offset = nodes_[previous].offset;
+    size += nodes_[previous].size;
+    RemoveFreeNode(previous);
+    unused_nodes_.push_back(previous);
+    nodes_[node].neighbor_previous = nodes_[previous].neighbor_previous;
+    previous = nodes_[node].neighbor_previous;
+  }
+  uint32_t next = nodes_[node].neighbor_next;
+  if (next != kNoSpace && !nodes_[next].used) {
+    size += nodes_[next].size;
+    RemoveFreeNode(next);
+    unused_nodes_.push_back(next);
+    nodes_[node].neighbor_next = nodes_[next].neighbor_next;
+    next = nodes_[node].neighbor_next;
+  }
+  nodes_[node].used = false;
+  unused_nodes_.push_back(node);
+
+  uint32_t merged = InsertFreeNode(offset, size);
+  nodes_[merged].neighbor_previous = previous;
+  nodes_[merged].neighbor_next = next;
+  if (previous != kNoSpace) {
+    nodes_[previous].neighbor_next = merged;
+  }
+  if (next != kNoSpace) {
+    nodes_[next].neighbor_previous = merged;
+  }
+}
+
+uint32_t OffsetAllocator::LargestFreeRegion() const {
+  if (top_bins_used_ == 0) {
+    return 0;
+  }
+  uint32_t top = highestSetBit(top_bins_used_);
+  uint32_t leaf = highestSetBit(leaf_bins_used_[top]);
+  return binSize(top * kLeafBinsPerTop + leaf);
+}
+
+uint32_t OffsetAllocator::InsertFreeNode(uint32_t offset, uint32_t size) {
+  uint32_t bin = binRoundingDown(size);
+  uint32_t top = bin / kLeafBinsPerTop;
+  uint32_t leaf = bin % kLeafBinsPerTop;
+  if (bin_heads_[bin] == kNoSpace) {
+    leaf_bins_used_[top] |= 1u << leaf;
+    top_bins_used_ |= 1u << top;
+  }
+
+  uint32_t node = unused_nodes_.back();
+  unused_nodes_.pop_back();
+  Node &inserted = nodes_[node];
+  inserted = Node();
+  inserted.offset = offset;
+  inserted.size = size;
+  inserted.bin_next = bin_heads_[bin];
+  if (bin_heads_[bin] != kNoSpace) {
+    nodes_[bin_heads_[bin]].bin_previous = node;
+  }
+  bin_heads_[bin] = node;
+  free_space_ += size;
+  return node;
+}
+
+void OffsetAllocator::RemoveFreeNode(uint32_t node) {
+  Node &removed = nodes_[node];
+  if (removed.bin_previous != kNoSpace) {
+    nodes_[removed.bin_previous].bin_next = removed.bin_next;
+    if (removed.bin_next != kNoSpace) {
+      nodes_[removed.bin_next].bin_previous = removed.bin_previous;
+    }
+  } else {
+    uint32_t bin = binRoundingDown(removed.size);
+    bin_heads_[bin] = removed.bin_next;
+    if (removed.bin_next != kNoSpace) {
+      nodes_[removed.bin_next].bin_previous = kNoSpace;
+    } else {
+      uint32_t top = bin / kLeafBinsPerTop;
+      leaf_bins_used_[top] &= ~(1u << (bin % kLeafBinsPerTop));
+      if (leaf_bins_used_[top] == 0) {
+        top_bins_used_ &= ~(1u << top);
+      }
+    }
+  }
+  removed.bin_previous = removed.bin_next = kNoSpace;
+  free_space_ -= removed.size;
+}
@@ -0,0 +1,71 @@
+#ifndef LEARNOPENGL_OFFSET_ALLOCATOR_H
+#define LEARNOPENGL_OFFSET_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Hands out ranges of an abstract space of Size() units, such as the elements of a GPU buffer,
+ * with constant-time allocation and freeing in the manner of TLSF (Masmoudi et al., "TLSF: a New
+ * Dynamic Memory Allocator for Real-Time Systems"). Free ranges are kept in 256 bins whose sizes
+ * follow a small floating point format: 5 bits of exponent and 3 of mantissa, so a bin never
+ * spans more than 12.5% of its size. Bitmasks over the bins find a fitting range with two bit
+ * scans, and freed ranges merge with free neighbours straight away.
+ *
+ * Nothing here touches the space itself, so one allocator serves any buffer.
+ */
+class OffsetAllocator {
+public:
+  static constexpr uint32_t kNoSpace = 0xFFFFFFFF;
+
+  struct Allocation {
+    // The first unit of the range, or kNoSpace if the allocation failed.
+    uint32_t offset = kNoSpace;
+    // Identifies the range for Free.
+    uint32_t node = kNoSpace;
+  };
+
+  /** max_allocations bounds the number of live and free ranges together. */
+  explicit OffsetAllocator(uint32_t size, uint32_t max_allocations = 128 * 1024);
+
+  /** Returns an Allocation whose offset is kNoSpace if no free range holds size units. */
+  Allocation Allocate(uint32_t size);
+  void Free(Allocation allocation);
+
+  uint32_t Size() const { return size_; }
+  uint32_t FreeSpace() const { return free_space_; }
+  /** The size of the largest allocation that would currently succeed, rounded down to a bin. */
+  uint32_t LargestFreeRegion() const;
+
+private:
+  static constexpr uint32_t kTopBins = 32;
+  static constexpr uint32_t kLeafBinsPerTop = 8;
+  static constexpr uint32_t kBins = kTopBins * kLeafBinsPerTop;
+
+  struct Node {
+    uint32_t offset = 0;
+    uint32_t size = 0;
+    // Free nodes of the same bin, as a doubly linked list.
+    uint32_t bin_previous = kNoSpace;
+    uint32_t bin_next = kNoSpace;
+    // The adjacent ranges, free or not, in order of offset.
+    uint32_t neighbor_previous = kNoSpace;
+    uint32_t neighbor_next = kNoSpace;
+    bool used = false;
+  };
+
+  uint32_t InsertFreeNode(uint32_t offset, uint32_t size);
+  void RemoveFreeNode(uint32_t node);
+
+  uint32_t size_;
+  uint32_t free_space_ = 0;
+  uint32_t top_bins_used_ = 0;
+  uint8_t leaf_bins_used_[kTopBins] = {};
+  uint32_t bin_heads_[kBins];
+  std::vector<Node> nodes_;
+  // Indices of nodes_ not currently describing any range.
+  std::vector<uint32_t> unused_nodes_;
+};
+
+#endif // LEARNOPENGL_OFFSET_ALLOCATOR_H
@@ -0,0 +1,357 @@
+#include "procedural_geometry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr float kPi = 3.14159265358979323846f;
+
+#if defined(__SSE2__)
+// sin and cos of four angles, after Cephes' sinf and cosf: reduce to [-pi/4, pi/4] with pi/2
+// split in three parts so the reduction stays exact, evaluate both minimax polynomials, and pick
+// and negate them by quadrant. Both come out of one reduction, which is the point of doing them
+// together.
+void sinCos4(__m128 x, __m128 *sines, __m128 *cosines) {
+  __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(2.0f / kPi)));
+  __m128 q = _mm_cvtepi32_ps(quadrant);
+  __m128 r = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(1.5703125f)));
+  r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(4.837512969970703125e-4f)));
+  r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(7.54978995489188216e-8f)));
+  __m128 r2 = _mm_mul_ps(r, r);
+
+  __m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), r2),
+                        _mm_set1_ps(8.3321608736e-3f));
+  s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(-1.6666654611e-1f));
+  s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, r2), r), r);
+  __m128 c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), r2),
+                        _mm_set1_ps(-1.388731625493765e-3f));
+  c = _mm_add_ps(_mm_mul_ps(c, r2), _mm_set1_ps(4.166664568298827e-2f));
+  c = _mm_mul_ps(_mm_mul_ps(c, r2), r2);
+  c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+  // Odd quadrants swap sin and cos; quadrants 2 and 3 negate sin, 1 and 2 negate cos.
+  __m128i one = _mm_set1_epi32(1);
+  __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+  __m128i two = _mm_set1_epi32(2);
+  __m128 sin_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+  __m128 cos_sign = _mm_castsi128_ps(
+      _mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+  __m128 sin_value = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+  __m128 cos_value = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+  *sines = _mm_xor_ps(sin_value, sin_sign);
+  *cosines = _mm_xor_ps(cos_value, cos_sign);
+}
+#endif
+
+struct SinCos {
+  std::vector<float> sines;
+  std::vector<float> cosines;
+};
+
+// sin and cos of count + 1 angles evenly spaced from start to end inclusive. The last entry is
+// copied from the first when the range is a full turn, so seams close exactly.
+SinCos sinCosTable(float start, float end, uint32_t count) {
+  SinCos table;
+  table.sines.resize(count + 1);
+  table.cosines.resize(count + 1);
+  SinCosTable(start, (end - start) / (float)count, count + 1, table.sines.data(),
+              table.cosines.data());
+  if (end - start == 2.0f * kPi) {
+    table.sines[count] = table.sines[0];
+    table.cosines[count] = table.cosines[0];
+  }
+  return table;
+}
+
+// Quads over a (columns + 1) x (rows + 1) grid of vertices numbered row by row from base, with
+// u along the rows and v across them. Counter-clockwise when u x v points out of the surface.
+void appendGridIndices(std::vector<uint32_t> &indices, uint32_t base, uint32_t columns,
+                       uint32_t rows) {
+  size_t index = indices.size();
+  indices.resize(index + (size_t)6 * columns * rows);
+  uint32_t *out = indices.data() + index;
+  for (uint32_t j = 0; j < rows; j++) {
+    for (uint32_t i = 0; i < columns; i++) {
+      uint32_t a = base + j * (columns + 1) + i;
+      uint32_t d = a + columns + 1;
+      out[0] = a, out[1] = a + 1, out[2] = d + 1;
+      out[3] = a, out[4] = d + 1, out[5] = d;
+      out += 6;
+    }
+  }
+}
+
+// A flat grid of quads centered on center, spanning u and v, with texture coordinates running
+// from 0 to 1 along each.
+void appendFace(IndexedMesh<MeshVertex> &mesh, const glm::vec3 &center, const glm::vec3 &u,
+                const glm::vec3 &v, const glm::vec3 &normal, uint32_t columns, uint32_t rows) {
+  auto base = (uint32_t)mesh.vertices.size();
+  mesh.vertices.resize(base + (size_t)(columns + 1) * (rows + 1));
+  MeshVertex *out = mesh.vertices.data() + base;
+  for (uint32_t j = 0; j <= rows; j++) {
+    float t = (float)j / (float)rows;
+    glm::vec3 row = center + (t - 0.5f) * v;
+    for (uint32_t i = 0; i <= columns; i++) {
+      float s = (float)i / (float)columns;
+      *out++ = {row + (s - 0.5f) * u, glm::vec2(s, t), normal};
+    }
+  }
+  appendGridIndices(mesh.indices, base, columns, rows);
+}
+
+constexpr uint64_t kNoEdge = std::numeric_limits<uint64_t>::max();
+
+struct EdgeMidpoint {
+  uint64_t key = kNoEdge;
+  uint32_t vertex = 0;
+};
+
+glm::vec3 toVec3(const float value[3]) { return glm::vec3(value[0], value[1], value[2]); }
+
+} // namespace
+
+void SinCosTable(float start, float step, size_t count, float *sines, float *cosines) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  __m128 steps = _mm_mul_ps(_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), _mm_set1_ps(step));
+  for (; i + 4 <= count; i += 4) {
+    __m128 angles = _mm_add_ps(_mm_set1_ps(start + (float)i * step), steps);
+    __m128 s, c;
+    sinCos4(angles, &s, &c);
+    _mm_storeu_ps(sines + i, s);
+    _mm_storeu_ps(cosines + i, c);
+  }
+  if (i < count) {
+    __m128 angles = _mm_add_ps(_mm_set1_ps(start + (float)i * step), steps);
+    float s[4], c[4];
+    __m128 sv, cv;
+    sinCos4(angles, &sv, &cv);
+    _mm_storeu_ps(s, sv);
+    _mm_storeu_ps(c, cv);
+    std::copy(s, s + (count - i), sines + i);
+    std::copy(c, c + (count - i), cosines + i);
+  }
+#else
+  for (; i < count; i++) {
+    float angle = start + (float)i * step;
+    sines[i] = std::sin(angle);
+    cosines[i] = std::cos(angle);
+  }
+#endif
+}
+
+IndexedMesh<MeshVertex> GenerateCube(uint32_t segments) {
+  segments = std::max(segments, 1u);
+  IndexedMesh<MeshVertex> mesh;
+  mesh.vertices.reserve((size_t)6 * (segments + 1) * (segments + 1));
+  mesh.indices.reserve((size_t)36 * segments * segments);
+  for (const CubeFace &face : kCubeFaces) {
+    glm::vec3 normal = toVec3(face.normal);
+    appendFace(mesh, 0.5f * normal, toVec3(face.u), toVec3(face.v), normal, segments, segments);
+  }
+  return mesh;
+}
+
+IndexedMesh<MeshVertex> GeneratePlane(uint32_t x_segments, uint32_t z_segments) {
+  IndexedMesh<MeshVertex> mesh;
+  appendFace(mesh, glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+             glm::vec3(0.0f, 1.0f, 0.0f), std::max(x_segments, 1u), std::max(z_segments, 1u));
+  return mesh;
+}
+
+IndexedMesh<MeshVertex> GenerateUvSphere(uint32_t slices, uint32_t stacks) {
+  slices = std::max(slices, 3u);
+  stacks = std::max(stacks, 2u);
+  SinCos longitude = sinCosTable(0.0f, 2.0f * kPi, slices);
+  SinCos latitude = sinCosTable(-0.5f * kPi, 0.5f * kPi, stacks);
+  // Make the poles exact, so the collapsed quads there meet at one point.
+  latitude.sines[0] = -1.0f, latitude.cosines[0] = 0.0f;
+  latitude.sines[stacks] = 1.0f, latitude.cosines[stacks] = 0.0f;
+
+  IndexedMesh<MeshVertex> mesh;
+  mesh.vertices.resize((size_t)(slices + 1) * (stacks + 1));
+  MeshVertex *out = mesh.vertices.data();
+  for (uint32_t j = 0; j <= stacks; j++) {
+    float t = (float)j / (float)stacks;
+    for (uint32_t i = 0; i <= slices; i++) {
+      glm::vec3 normal(latitude.cosines[j] * longitude.sines[i], latitude.sines[j],
+                       latitude.cosines[j] * longitude.cosines[i]);
+      *out++ = {0.5f * normal, glm::vec2((float)i / (float)slices, t), normal};
+    }
+  }
+
+  // As appendGridIndices, minus the triangles of the quads touching the poles that have collapsed.
+  mesh.indices.resize((size_t)6 * slices * (stacks - 1));
+  uint32_t *indices = mesh.indices.data();
+  for (uint32_t j = 0; j < stacks; j++) {
+    for (uint32_t i = 0; i < slices; i++) {
+      uint32_t a = j * (slices + 1) + i;
+      uint32_t d = a + slices + 1;
+      if (j != 0) {
+        indices[0] = a, indices[1] = a + 1, indices[2] = d + 1;
+        indices += 3;
+      }
+      if (j != stacks - 1) {
+        indices[0] = a, indices[1] = d + 1, indices[2] = d;
+        indices += 3;
+      }
+    }
+  }
+  return mesh;
+}
+
+IndexedMesh<MeshVertex> GenerateIcosphere(uint32_t subdivisions) {
+  const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+  std::vector<glm::vec3> positions = {
+      {-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0}, {0, -1, t}, {0, 1, t},
+      {0, -1, -t}, {0, 1, -t}, {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1},
+  };
+  std::vector<uint32_t> indices = {
+      0, 11, 5, 0, 5,  1,  0,  1,  7,  0,  7,  10, 0, 10, 11, 1, 5, 9, 5, 11,
+      4, 11, 10, 2, 10, 7, 6,  7,  1,  8,  3,  9,  4, 3,  4,  2, 3, 2, 6, 3,
+      6, 8,  3,  8, 9,  4, 9,  5,  2,  4,  11, 6,  2, 10, 8,  6, 7, 9, 8, 1,
+  };
+  for (glm::vec3 &position : positions) {
+    position = glm::normalize(position);
+  }
+
+  // Each level splits every triangle into four at its edge midpoints, shared between the two
+  // triangles of an edge through a table keyed by the edge's vertices: open addressing with linear
+  // probing, kept at most half full.
+  for (uint32_t level = 0; level < subdivisions; level++) {
+    size_t table_size = 1;
+    while (table_size < indices.size()) {
+      table_size *= 2;
+    }
+    std::vector<EdgeMidpoint> midpoints(table_size);
+    size_t mask = table_size - 1;
+    positions.reserve(positions.size() + indices.size() / 2);
+    auto midpoint = [&](uint32_t a, uint32_t b) {
+      uint64_t key = ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+      size_t slot = (size_t)((key * 0x9e3779b97f4a7c15ull) >> 32) & mask;
+      while (midpoints[slot].key != kNoEdge && midpoints[slot].key != key) {
+        slot = (slot + 1) & mask;
+      }
+      if (midpoints[slot].key == kNoEdge) {
+        midpoints[slot] = {key, (uint32_t)positions.size()};
+        positions.push_back(glm::normalize(positions[a] + positions[b]));
+      }
+      return midpoints[slot].vertex;
+    };
+    std::vector<uint32_t> split(indices.size() * 4);
+    for (size_t i = 0; i < indices.size(); i += 3) {
+      uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+      uint32_t ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+      uint32_t *out = &split[i * 4];
+      out[0] = a, out[1] = ab, out[2] = ca;
+      out[3] = b, out[4] = bc, out[5] = ab;
+      out[6] = c, out[7] = ca, out[8] = bc;
+      out[9] = ab, out[10] = bc, out[11] = ca;
+    }
+    indices = std::move(split);
+  }
+
+  IndexedMesh<MeshVertex> mesh;
+  mesh.vertices.resize(positions.size());
+  for (size_t i = 0; i < positions.size(); i++) {
+    const glm::vec3 &normal = positions[i];
+    glm::vec2 tex_coord(std::atan2(normal.x, normal.z) / (2.0f * kPi) + 0.5f,
+                        std::asin(std::clamp(normal.y, -1.0f, 1.0f)) / kPi + 0.5f);
+    mesh.vertices[i] = {0.5f * normal, tex_coord, normal};
+  }
+  mesh.indices = std::move(indices);
+  return mesh;
+}
+
+IndexedMesh<MeshVertex> GenerateCylinder(uint32_t slices, uint32_t stacks) {
+  slices = std::max(slices, 3u);
+  stacks = std::max(stacks, 1u);
+  SinCos around = sinCosTable(0.0f, 2.0f * kPi, slices);
+
+  IndexedMesh<MeshVertex> mesh;
+  size_t ring = slices + 1;
+  mesh.vertices.resize(ring * (stacks + 1) + 2 * (ring + 1));
+  mesh.indices.reserve((size_t)6 * slices * stacks + (size_t)6 * slices);
+  MeshVertex *out = mesh.vertices.data();
+  for (uint32_t j = 0; j <= stacks; j++) {
+    float t = (float)j / (float)stacks;
+    for (uint32_t i = 0; i <= slices; i++) {
+      glm::vec3 normal(around.sines[i], 0.0f, around.cosines[i]);
+      *out++ = {glm::vec3(0.5f * normal.x, t - 0.5f, 0.5f * normal.z),
+                glm::vec2((float)i / (float)slices, t), normal};
+    }
+  }
+  appendGridIndices(mesh.indices, 0, slices, stacks);
+
+  // The caps are fans around their centers, with the texture mapped onto them as a disc.
+  for (float y : {0.5f, -0.5f}) {
+    auto center = (uint32_t)(out - mesh.vertices.data());
+    glm::vec3 normal(0.0f, y * 2.0f, 0.0f);
+    *out++ = {glm::vec3(0.0f, y, 0.0f), glm::vec2(0.5f), normal};
+    for (uint32_t i = 0; i <= slices; i++) {
+      *out++ = {glm::vec3(0.5f * around.sines[i], y, 0.5f * around.cosines[i]),
+                glm::vec2(0.5f + 0.5f * around.sines[i], 0.5f + 0.5f * around.cosines[i]), normal};
+    }
+    for (uint32_t i = 0; i < slices; i++) {
+      uint32_t a = center + 1 + i;
+      if (y > 0.0f) {
+        mesh.indices.insert(mesh.indices.end(), {center, a, a + 1});
+      } else {
+        mesh.indices.insert(mesh.indices.end(), {center, a + 1, a});
+      }
+    }
+  }
+  return mesh;
+}
+
+IndexedMesh<MeshVertex> GenerateTorus(uint32_t major_segments, uint32_t minor_segments,
+                                      float minor_radius) {
+  major_segments = std::max(major_segments, 3u);
+  minor_segments = std::max(minor_segments, 3u);
+  float major_radius = 0.5f - minor_radius;
+  SinCos major = sinCosTable(0.0f, 2.0f * kPi, major_segments);
+  SinCos minor = sinCosTable(0.0f, 2.0f * kPi, minor_segments);
+
+  IndexedMesh<MeshVertex> mesh;
+  mesh.vertices.resize((size_t)(major_segments + 1) * (minor_segments + 1));
+  MeshVertex *out = mesh.vertices.data();
+  for (uint32_t j = 0; j <= minor_segments; j++) {
+    float t = (float)j / (float)minor_segments;
+    float distance = major_radius + minor_radius * minor.cosines[j];
+    for (uint32_t i = 0; i <= major_segments; i++) {
+      glm::vec3 normal(minor.cosines[j] * major.sines[i], minor.sines[j],
+                       minor.cosines[j] * major.cosines[i]);
+      glm::vec3 position(distance * major.sines[i], minor_radius * minor.sines[j],
+                         distance * major.cosines[i]);
+      *out++ = {position, glm::vec2((float)i / (float)major_segments, t), normal};
+    }
+  }
+  appendGridIndices(mesh.indices, 0, major_segments, minor_segments);
+  return mesh;
+}
+
+PackedMesh PackMesh(const IndexedMesh<MeshVertex> &mesh) {
+  PackedMesh packed;
+  size_t count = mesh.vertices.size();
+  packed.vertices.resize(count);
+  if (count > 0) {
+    const MeshVertex &first = mesh.vertices[0];
+    PackedMeshVertex &out = packed.vertices[0];
+    packed.quantization =
+        ComputePositionQuantization(&first.position, sizeof(MeshVertex), count);
+    EncodePositions(packed.quantization, &first.position, sizeof(MeshVertex), count,
+                    &out.position, sizeof(PackedMeshVertex));
+    EncodeNormals(&first.normal, sizeof(MeshVertex), count, &out.normal,
+                  sizeof(PackedMeshVertex));
+    EncodeTexCoords(&first.tex_coord, sizeof(MeshVertex), count, &out.tex_coord,
+                    sizeof(PackedMeshVertex));
+  }
+  packed.indices = PackIndices(mesh.indices, count);
+  return packed;
+}
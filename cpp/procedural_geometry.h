@@ -0,0 +1,211 @@
+#ifndef LEARNOPENGL_PROCEDURAL_GEOMETRY_H
+#define LEARNOPENGL_PROCEDURAL_GEOMETRY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "mesh.h"
+#include "mesh_loader.h"
+#include "mesh_processing.h"
+#include "vertex_quantization.h"
+
+// Generators for common shapes at any tessellation. Every shape fits the unit cube centered on the
+// origin (a sphere has radius 0.5), winds its triangles counter-clockwise seen from outside, and
+// has unit normals and texture coordinates in [0, 1]. Seams where texture coordinates wrap have
+// their own vertices, except on the icosphere. Triangle counts are given for each shape, so the
+// fixed-size constexpr variants below can size their arrays.
+
+/** segments x segments quads per face, with each face mapping the whole texture. */
+IndexedMesh<MeshVertex> GenerateCube(uint32_t segments = 1);
+
+/** x_segments x z_segments quads in the XZ plane, facing +Y. */
+IndexedMesh<MeshVertex> GeneratePlane(uint32_t x_segments = 1, uint32_t z_segments = 1);
+
+/**
+ * slices around the Y axis and stacks from pole to pole, so 2 * slices * (stacks - 1) triangles.
+ * Needs at least 3 slices and 2 stacks.
+ */
+IndexedMesh<MeshVertex> GenerateUvSphere(uint32_t slices, uint32_t stacks);
+
+/**
+ * An icosahedron with each triangle split into four subdivisions times, so 20 * 4^subdivisions
+ * evenly sized triangles.
+ */
+IndexedMesh<MeshVertex> GenerateIcosphere(uint32_t subdivisions);
+
+/** Around the Y axis, with caps, so 2 * slices * stacks + 2 * slices triangles. */
+IndexedMesh<MeshVertex> GenerateCylinder(uint32_t slices, uint32_t stacks = 1);
+
+/**
+ * Around the Y axis, major_segments around the ring and minor_segments around the tube, so
+ * 2 * major_segments * minor_segments triangles. The tube's radius is minor_radius and the ring's
+ * is 0.5 - minor_radius.
+ */
+IndexedMesh<MeshVertex> GenerateTorus(uint32_t major_segments, uint32_t minor_segments,
+                                      float minor_radius = 0.125f);
+
+/** MeshVertex quantized to 16 bytes. */
+struct PackedMeshVertex {
+  Snorm16x4 position;
+  PackedNormal normal;
+  Unorm16x2 tex_coord;
+
+  static constexpr std::array<VertexAttribute, 3> Layout() {
+    return {VERTEX_ATTRIBUTE(PackedMeshVertex, position, 0),
+            VERTEX_ATTRIBUTE(PackedMeshVertex, tex_coord, 1),
+            VERTEX_ATTRIBUTE(PackedMeshVertex, normal, MeshVertex::kNormalLocation)};
+  }
+};
+
+/** A quantized mesh, ready for Mesh<PackedMeshVertex>; draw it with DequantizationMatrix(). */
+struct PackedMesh {
+  std::vector<PackedMeshVertex> vertices;
+  IndexData indices;
+  PositionQuantization quantization;
+};
+
+/** Quantizes a generated (or any) mesh, with 16-bit indices where they suffice. */
+PackedMesh PackMesh(const IndexedMesh<MeshVertex> &mesh);
+
+/**
+ * Computes sin and cos of start + i * step for i in [0, count). Four at a time with SSE2, good to
+ * a few ulps for angles of moderate size.
+ */
+void SinCosTable(float start, float step, size_t count, float *sines, float *cosines);
+
+// Compile-time variants for small fixed shapes, e.g.
+//
+//   constexpr auto kCube = MakeCube();
+//   Mesh<MeshVertex> cube(kCube.vertices.data(), kCube.vertices.size(), kCube.indices.data(),
+//                         kCube.indices.size());
+
+template <size_t VertexCount, size_t IndexCount>
+struct FixedMesh {
+  std::array<MeshVertex, VertexCount> vertices;
+  std::array<uint16_t, IndexCount> indices;
+
+  IndexedMesh<MeshVertex> ToIndexedMesh() const {
+    return {{vertices.begin(), vertices.end()}, {indices.begin(), indices.end()}};
+  }
+};
+
+/** sin and cos for constant expressions, where the standard library has none. */
+constexpr void ConstexprSinCos(double angle, double &sine, double &cosine) {
+  constexpr double kPi = 3.14159265358979323846;
+  // Reduce to [-pi/4, pi/4] and a quadrant, then use Taylor series, which converge quickly there.
+  double quadrant = angle * (2.0 / kPi);
+  long q = (long)(quadrant >= 0.0 ? quadrant + 0.5 : quadrant - 0.5);
+  double r = angle - (double)q * (kPi / 2.0);
+  double r2 = r * r;
+  double s = r, c = 1.0, term_s = r, term_c = 1.0;
+  for (int n = 1; n < 12; n++) {
+    term_s *= -r2 / ((2 * n) * (2 * n + 1));
+    term_c *= -r2 / ((2 * n - 1) * (2 * n));
+    s += term_s;
+    c += term_c;
+  }
+  switch (((q % 4) + 4) % 4) {
+  case 0:
+    sine = s, cosine = c;
+    break;
+  case 1:
+    sine = c, cosine = -s;
+    break;
+  case 2:
+    sine = -s, cosine = -c;
+    break;
+  default:
+    sine = -c, cosine = s;
+    break;
+  }
+}
+
+/** Each face of the cube: its normal, and the directions in which u and v increase. */
+struct CubeFace {
+  float normal[3];
+  float u[3];
+  float v[3];
+};
+
+constexpr CubeFace kCubeFaces[6] = {
+    {{1, 0, 0}, {0, 0, -1}, {0, 1, 0}},  {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}},
+    {{0, 1, 0}, {1, 0, 0}, {0, 0, -1}},  {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}},
+    {{0, 0, 1}, {1, 0, 0}, {0, 1, 0}},   {{0, 0, -1}, {-1, 0, 0}, {0, 1, 0}},
+};
+
+template <uint32_t Segments = 1>
+constexpr auto MakeCube() {
+  static_assert(Segments > 0 && 6 * (Segments + 1) * (Segments + 1) <= 65536);
+  constexpr uint32_t kSide = Segments + 1;
+  FixedMesh<6 * kSide * kSide, 36 * Segments * Segments> mesh = {};
+  size_t vertex = 0, index = 0;
+  for (const CubeFace &face : kCubeFaces) {
+    auto base = (uint16_t)vertex;
+    for (uint32_t j = 0; j < kSide; j++) {
+      for (uint32_t i = 0; i < kSide; i++) {
+        float s = (float)i / Segments, t = (float)j / Segments;
+        float p[3] = {};
+        for (int axis = 0; axis < 3; axis++) {
+          p[axis] =
+              0.5f * face.normal[axis] + (s - 0.5f) * face.u[axis] + (t - 0.5f) * face.v[axis];
+        }
+        mesh.vertices[vertex++] = {glm::vec3(p[0], p[1], p[2]), glm::vec2(s, t),
+                                   glm::vec3(face.normal[0], face.normal[1], face.normal[2])};
+      }
+    }
+    for (uint32_t j = 0; j < Segments; j++) {
+      for (uint32_t i = 0; i < Segments; i++) {
+        auto a = (uint16_t)(base + j * kSide + i);
+        auto d = (uint16_t)(a + kSide);
+        uint16_t quad[6] = {a, (uint16_t)(a + 1), (uint16_t)(d + 1), a, (uint16_t)(d + 1), d};
+        for (uint16_t corner : quad) {
+          mesh.indices[index++] = corner;
+        }
+      }
+    }
+  }
+  return mesh;
+}
+
+template <uint32_t Slices, uint32_t Stacks>
+constexpr auto MakeUvSphere() {
+  static_assert(Slices >= 3 && Stacks >= 2 && (Slices + 1) * (Stacks + 1) <= 65536);
+  constexpr double kPi = 3.14159265358979323846;
+  FixedMesh<(Slices + 1) * (Stacks + 1), 6 * Slices * (Stacks - 1)> mesh = {};
+  size_t vertex = 0, index = 0;
+  for (uint32_t j = 0; j <= Stacks; j++) {
+    double sin_latitude = 0.0, cos_latitude = 0.0;
+    ConstexprSinCos(kPi * ((double)j / Stacks - 0.5), sin_latitude, cos_latitude);
+    for (uint32_t i = 0; i <= Slices; i++) {
+      double sin_longitude = 0.0, cos_longitude = 0.0;
+      ConstexprSinCos(2.0 * kPi * i / Slices, sin_longitude, cos_longitude);
+      glm::vec3 normal((float)(cos_latitude * sin_longitude), (float)sin_latitude,
+                       (float)(cos_latitude * cos_longitude));
+      mesh.vertices[vertex++] = {glm::vec3(normal.x * 0.5f, normal.y * 0.5f, normal.z * 0.5f),
+                                 glm::vec2((float)i / Slices, (float)j / Stacks), normal};
+    }
+  }
+  // The quads touching the poles collapse to one triangle each.
+  for (uint32_t j = 0; j < Stacks; j++) {
+    for (uint32_t i = 0; i < Slices; i++) {
+      auto a = (uint16_t)(j * (Slices + 1) + i);
+      auto d = (uint16_t)(a + Slices + 1);
+      if (j != 0) {
+        mesh.indices[index++] = a;
+        mesh.indices[index++] = (uint16_t)(a + 1);
+        mesh.indices[index++] = (uint16_t)(d + 1);
+      }
+      if (j != Stacks - 1) {
+        mesh.indices[index++] = a;
+        mesh.indices[index++] = (uint16_t)(d + 1);
+        mesh.indices[index++] = d;
+      }
+    }
+  }
+  return mesh;
+}
+
+#endif // LEARNOPENGL_PROCEDURAL_GEOMETRY_H
@@ -0,0 +1,161 @@
+#include "render_queue.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr uint32_t kPassBits = 4;
+constexpr uint32_t kProgramBits = 12;
+constexpr uint32_t kMaterialBits = 16;
+constexpr uint32_t kVaoBits = 12;
+constexpr uint32_t kDepthBits = 20;
+static_assert(kPassBits + kProgramBits + kMaterialBits + kVaoBits + kDepthBits == 64);
+
+constexpr uint64_t field(uint64_t value, uint32_t bits, uint32_t shift) {
+  return (value & ((uint64_t(1) << bits) - 1)) << shift;
+}
+
+constexpr unsigned int kUnbound = ~0u;
+
+} // namespace
+
+uint64_t RenderQueue::Key(const State &state, bool back_to_front) {
+  constexpr uint32_t kDepthMax = (1u << kDepthBits) - 1;
+  auto depth = (uint32_t)(std::clamp(state.depth, 0.0f, 1.0f) * (float)kDepthMax);
+  if (back_to_front) {
+    depth = kDepthMax - depth;
+  }
+  constexpr uint32_t kVaoShift = kDepthBits;
+  constexpr uint32_t kMaterialShift = kVaoShift + kVaoBits;
+  constexpr uint32_t kProgramShift = kMaterialShift + kMaterialBits;
+  constexpr uint32_t kPassShift = kProgramShift + kProgramBits;
+  return field(state.pass, kPassBits, kPassShift) |
+         field(state.program, kProgramBits, kProgramShift) |
+         field(state.material, kMaterialBits, kMaterialShift) |
+         field(state.vao, kVaoBits, kVaoShift) | depth;
+}
+
+uint32_t RenderQueue::AddMaterial(const Material &material) {
+  materials_.push_back(material);
+  return (uint32_t)materials_.size() - 1;
+}
+
+void RenderQueue::SetBackToFront(uint32_t pass, bool back_to_front) {
+  if (back_to_front) {
+    back_to_front_passes_ |= 1u << pass;
+  } else {
+    back_to_front_passes_ &= ~(1u << pass);
+  }
+}
+
+void RenderQueue::Clear() {
+  entries_.clear();
+  keys_.clear();
+}
+
+void RenderQueue::Add(const State &state, const Draw &draw) {
+  bool back_to_front = state.pass < kMaxPasses && (back_to_front_passes_ & (1u << state.pass));
+  keys_.push_back(Key(state, back_to_front));
+  entries_.push_back({state.program, state.material, state.vao, draw});
+}
+
+void RenderQueue::Sort() {
+  size_t count = keys_.size();
+  sorted_keys_ = keys_;
+  order_.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    order_[i] = (uint32_t)i;
+  }
+  scratch_keys_.resize(count);
+  scratch_order_.resize(count);
+
+  // All eight histograms in one pass over the keys.
+  uint32_t histograms[8][256] = {};
+  for (uint64_t key : keys_) {
+    for (int byte = 0; byte < 8; byte++) {
+      histograms[byte][(key >> (byte * 8)) & 0xFF]++;
+    }
+  }
+
+  for (int byte = 0; byte < 8; byte++) {
+    uint32_t *histogram = histograms[byte];
+    // Every key has the same value in this byte, so this pass would not move anything.
+    if (histogram[(sorted_keys_[0] >> (byte * 8)) & 0xFF] == count) {
+      continue;
+    }
+    uint32_t offset = 0;
+    for (int bucket = 0; bucket < 256; bucket++) {
+      uint32_t size = histogram[bucket];
+      histogram[bucket] = offset;
+      offset += size;
+    }
+    // Scattering in order keeps the sort stable, which the less significant passes rely on.
+    for (size_t i = 0; i < count; i++) {
+      uint32_t slot = histogram[(sorted_keys_[i] >> (byte * 8)) & 0xFF]++;
+      scratch_keys_[slot] = sorted_keys_[i];
+      scratch_order_[slot] = order_[i];
+    }
+    sorted_keys_.swap(scratch_keys_);
+    order_.swap(scratch_order_);
+  }
+}
+
+RenderQueue::Statistics RenderQueue::Replay() {
+  Statistics statistics;
+  if (keys_.empty()) {
+    return statistics;
+  }
+  Sort();
+
+  unsigned int program = kUnbound;
+  unsigned int vao = kUnbound;
+  uint32_t material = kUnbound;
+  std::array<unsigned int, kMaxTextures> textures;
+  textures.fill(kUnbound);
+  for (uint32_t index : order_) {
+    const Entry &entry = entries_[index];
+    if (entry.program != program) {
+      program = entry.program;
+      glUseProgram(program);
+      statistics.program_changes++;
+    }
+    if (entry.material != material && entry.material < materials_.size()) {
+      material = entry.material;
+      statistics.material_changes++;
+      // Materials often share textures, so bind only the units that actually change.
+      const Material &bound = materials_[material];
+      for (size_t unit = 0; unit < kMaxTextures; unit++) {
+        if (bound.textures[unit] != 0 && bound.textures[unit] != textures[unit]) {
+          textures[unit] = bound.textures[unit];
+          glActiveTexture(GL_TEXTURE0 + (GLenum)unit);
+          glBindTexture(GL_TEXTURE_2D, textures[unit]);
+          statistics.texture_changes++;
+        }
+      }
+    }
+
+    const Draw &draw = entry.draw;
+    if (draw.draw_list != nullptr) {
+      // The list binds its own vertex array.
+      draw.draw_list->Submit(draw.mode, draw.first, draw.count);
+      vao = draw.draw_list->Vao();
+    } else {
+      if (entry.vao != vao) {
+        vao = entry.vao;
+        glBindVertexArray(vao);
+        statistics.vao_changes++;
+      }
+      if (draw.index_type == 0) {
+        glDrawArraysInstanced(draw.mode, (GLint)draw.first, (GLsizei)draw.count,
+                              (GLsizei)draw.instance_count);
+      } else {
+        glDrawElementsInstancedBaseVertex(
+            draw.mode, (GLsizei)draw.count, draw.index_type,
+            (void *)(draw.first * IndexSize(draw.index_type)), (GLsizei)draw.instance_count,
+            draw.base_vertex);
+      }
+    }
+    statistics.draws++;
+  }
+  return statistics;
+}
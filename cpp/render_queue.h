@@ -0,0 +1,131 @@
+#ifndef LEARNOPENGL_RENDER_QUEUE_H
+#define LEARNOPENGL_RENDER_QUEUE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "draw_list.h"
+#include "mesh.h"
+#include "mesh_pool.h"
+#include "opengl.h"
+
+/**
+ * Collects a frame's draws, each with the state it needs, sorts them by a 64-bit key and replays
+ * them changing only the state that differs from the previous draw. From the most significant
+ * bits down, the key holds:
+ *
+ *   pass (4 bits) | program (12) | material (16) | vertex array (12) | depth (20)
+ *
+ * so draws are grouped by pass first, then by program, the costliest state to switch, then by
+ * textures and vertex arrays, and finally ordered by depth within a group. Programs and vertex
+ * arrays enter the key as their GL names, truncated; that only affects the order, because replay
+ * compares the actual names before binding anything.
+ *
+ * The sort is an LSD radix sort, eight passes over the key bytes, skipping bytes that are equal
+ * across the whole queue, which in practice is most of them.
+ */
+class RenderQueue {
+public:
+  static constexpr size_t kMaxTextures = 4;
+  static constexpr uint32_t kMaxPasses = 16;
+
+  /** Textures bound to units 0 to kMaxTextures - 1; zero leaves a unit alone. */
+  struct Material {
+    std::array<unsigned int, kMaxTextures> textures = {};
+  };
+
+  /** What a draw needs bound. */
+  struct State {
+    uint32_t pass = 0;
+    // A linked program, e.g. Shader::ID after Shader::use() or isReady().
+    unsigned int program = 0;
+    // From AddMaterial.
+    uint32_t material = 0;
+    unsigned int vao = 0;
+    // Normalized depth in [0, 1], such as view distance over the far plane distance. Within a
+    // state group, draws go front to back, or back to front in passes set with SetBackToFront.
+    float depth = 0.0f;
+  };
+
+  /** One draw call, issued once its State is bound. */
+  struct Draw {
+    GLenum mode = GL_TRIANGLES;
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, or 0 to draw vertices without indices.
+    GLenum index_type = 0;
+    // Indices or vertices, or commands of draw_list.
+    uint32_t first = 0;
+    uint32_t count = 0;
+    int32_t base_vertex = 0;
+    uint32_t instance_count = 1;
+    // When set, first and count select commands of this list, which draws them itself.
+    const DrawList *draw_list = nullptr;
+
+    template <typename Vertex>
+    static Draw Whole(const Mesh<Vertex> &mesh, GLenum mode = GL_TRIANGLES) {
+      bool indexed = mesh.IndexType() != 0;
+      return {mode, mesh.IndexType(), 0,
+              (uint32_t)(indexed ? mesh.IndexCount() : mesh.VertexCount())};
+    }
+
+    template <typename Vertex, typename Index>
+    static Draw Pooled(const MeshPool<Vertex, Index> &pool, const PooledMesh &mesh,
+                       GLenum mode = GL_TRIANGLES) {
+      return {mode, pool.IndexType(), mesh.FirstIndex(), mesh.index_count, mesh.BaseVertex()};
+    }
+
+    static Draw List(const DrawList &list, GLenum mode = GL_TRIANGLES) {
+      return {mode, 0, 0, (uint32_t)list.Size(), 0, 1, &list};
+    }
+  };
+
+  /** How much state the last Replay changed. */
+  struct Statistics {
+    size_t draws = 0;
+    size_t program_changes = 0;
+    size_t material_changes = 0;
+    size_t texture_changes = 0;
+    size_t vao_changes = 0;
+  };
+
+  static uint64_t Key(const State &state, bool back_to_front = false);
+
+  /** Returns the material's id for State::material. */
+  uint32_t AddMaterial(const Material &material);
+  void SetBackToFront(uint32_t pass, bool back_to_front = true);
+
+  void Clear();
+  void Add(const State &state, const Draw &draw);
+  size_t Size() const { return keys_.size(); }
+
+  /**
+   * Sorts the queued draws and issues them, leaving their state bound. The queue is kept, so a
+   * scene that does not change can be replayed every frame. Bindings are not tracked between
+   * calls, so the first draw binds everything.
+   */
+  Statistics Replay();
+
+private:
+  struct Entry {
+    unsigned int program;
+    uint32_t material;
+    unsigned int vao;
+    Draw draw;
+  };
+
+  void Sort();
+
+  std::vector<Material> materials_;
+  uint32_t back_to_front_passes_ = 0;
+  std::vector<Entry> entries_;
+  // Each entry's sort key. Sorting leaves these alone and orders copies, with the entries they
+  // belong to, so a queue can be replayed again without being rebuilt.
+  std::vector<uint64_t> keys_;
+  std::vector<uint64_t> sorted_keys_;
+  std::vector<uint32_t> order_;
+  std::vector<uint64_t> scratch_keys_;
+  std::vector<uint32_t> scratch_order_;
+};
+
+#endif // LEARNOPENGL_RENDER_QUEUE_H
@@ -0,0 +1,117 @@
+#include "ring_buffer.h"
+
+#include <iostream>
+
+#include "common.h"
+
+namespace {
+
+// glad only loads glBufferStorage for GL 4.4 contexts, so on 3.3 it comes from the extension.
+PFNGLBUFFERSTORAGEPROC bufferStorage() {
+  static const PFNGLBUFFERSTORAGEPROC function = []() -> PFNGLBUFFERSTORAGEPROC {
+    if (glBufferStorage != nullptr) {
+      return glBufferStorage;
+    }
+    if (!hasExtension("GL_ARB_buffer_storage")) {
+      return nullptr;
+    }
+    return (PFNGLBUFFERSTORAGEPROC)glfwGetProcAddress("glBufferStorage");
+  }();
+  return function;
+}
+
+constexpr GLbitfield kPersistentFlags =
+    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+} // namespace
+
+RingBuffer::RingBuffer(size_t frame_size) : frame_size_(frame_size) {
+  GLint alignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  if (alignment > 0) {
+    uniform_alignment_ = alignment;
+  }
+  // Regions start on a uniform block boundary, so that every frame can be laid out alike.
+  frame_size_ = (frame_size_ + uniform_alignment_ - 1) / uniform_alignment_ * uniform_alignment_;
+
+  glGenBuffers(1, &buffer_);
+  glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+  size_t size = frame_size_ * kFramesInFlight;
+  if (PFNGLBUFFERSTORAGEPROC storage = bufferStorage()) {
+    storage(GL_ARRAY_BUFFER, size, nullptr, kPersistentFlags);
+    mapping_ =
+        static_cast<unsigned char *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, kPersistentFlags));
+  }
+  if (mapping_ == nullptr) {
+    // Immutable storage cannot be respecified, so start over with a mutable buffer.
+    glDeleteBuffers(1, &buffer_);
+    glGenBuffers(1, &buffer_);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+    glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    staging_.resize(frame_size_);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+RingBuffer::~RingBuffer() {
+  for (GLsync fence : fences_) {
+    glDeleteSync(fence);
+  }
+  if (mapping_ != nullptr) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+  glDeleteBuffers(1, &buffer_);
+}
+
+void RingBuffer::BeginFrame() {
+  frame_ = (frame_ + 1) % kFramesInFlight;
+  head_ = 0;
+  flushed_ = 0;
+  if (GLsync fence = fences_[frame_]) {
+    // Flushing on the first wait makes sure the fence itself has been submitted.
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while (glClientWaitSync(fence, flags, 1000000000) == GL_TIMEOUT_EXPIRED) {
+      flags = 0;
+    }
+    glDeleteSync(fence);
+    fences_[frame_] = nullptr;
+  }
+  if (mapping_ == nullptr && frame_ == 0) {
+    // The GPU may still read the other regions of the old storage; orphaning hands it new storage
+    // rather than waiting.
+    glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+    glBufferData(GL_ARRAY_BUFFER, frame_size_ * kFramesInFlight, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+}
+
+RingBuffer::Allocation RingBuffer::Allocate(size_t size, size_t alignment) {
+  size_t region = frame_ * frame_size_;
+  size_t offset = (region + head_ + alignment - 1) / alignment * alignment;
+  size_t start = offset - region;
+  if (start > frame_size_ || size > frame_size_ - start) {
+    std::cerr << "Error: ring buffer frame of " << frame_size_ << " bytes is full" << std::endl;
+    return {nullptr, 0};
+  }
+  head_ = start + size;
+  return {mapping_ != nullptr ? mapping_ + offset : staging_.data() + start, offset};
+}
+
+void RingBuffer::Flush() {
+  if (mapping_ == nullptr && head_ > flushed_) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+    glBufferSubData(GL_ARRAY_BUFFER, frame_ * frame_size_ + flushed_, head_ - flushed_,
+                    staging_.data() + flushed_);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+  flushed_ = head_;
+}
+
+void RingBuffer::EndFrame() {
+  // Orphaning already keeps the fallback from waiting, so only the mapping needs fences.
+  if (mapping_ != nullptr) {
+    fences_[frame_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef LEARNOPENGL_RING_BUFFER_H
+#define LEARNOPENGL_RING_BUFFER_H
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "opengl.h"
+
+/**
+ * A buffer for data that changes every frame, such as instance matrices and per-frame uniforms.
+ * It is split into one region per frame in flight, so the CPU fills one region while the GPU still
+ * reads the others. A fence guards each region, and BeginFrame only waits if the GPU has fallen
+ * kFramesInFlight frames behind.
+ *
+ * With ARB_buffer_storage (core in GL 4.4) the buffer stays mapped, persistently and coherently.
+ * Allocate then returns a pointer into GL's memory, and writes reach the GPU with no copies and no
+ * calls. Without it, writes go to a staging copy that Flush uploads with glBufferSubData. The
+ * whole buffer is orphaned each time the regions wrap around, so uploads never wait on the GPU.
+ *
+ * Usage per frame: BeginFrame, then Allocate and write, then Flush, then draw, then EndFrame.
+ */
+class RingBuffer {
+public:
+  static constexpr size_t kFramesInFlight = 3;
+
+  /** Makes at least frame_size bytes available to each frame. */
+  explicit RingBuffer(size_t frame_size);
+  RingBuffer(const RingBuffer &) = delete;
+  RingBuffer &operator=(const RingBuffer &) = delete;
+  ~RingBuffer();
+
+  unsigned int Buffer() const { return buffer_; }
+  /** Whether the buffer is persistently mapped rather than uploaded by Flush. */
+  bool Persistent() const { return mapping_ != nullptr; }
+  /** The offset alignment glBindBufferRange requires for GL_UNIFORM_BUFFER. */
+  size_t UniformAlignment() const { return uniform_alignment_; }
+
+  /** Moves on to the next region, waiting until the GPU has finished reading it. */
+  void BeginFrame();
+
+  struct Allocation {
+    // Where to write, valid until Flush. nullptr if the frame's region is full.
+    void *data;
+    // Where the data will be in Buffer().
+    size_t offset;
+  };
+
+  /** Reserves size bytes in the current frame, at an offset that is a multiple of alignment. */
+  Allocation Allocate(size_t size, size_t alignment = 16);
+
+  /** Makes everything allocated so far visible to GL. A no-op when persistently mapped. */
+  void Flush();
+
+  /** Fences the region, once every command reading it this frame has been issued. */
+  void EndFrame();
+
+private:
+  unsigned int buffer_ = 0;
+  size_t frame_size_;
+  size_t uniform_alignment_ = 256;
+  // The persistent mapping of the whole buffer, or nullptr when falling back to uploads.
+  unsigned char *mapping_ = nullptr;
+  // Fallback only: what has been written to the current region.
+  std::vector<unsigned char> staging_;
+  std::array<GLsync, kFramesInFlight> fences_ = {};
+  size_t frame_ = kFramesInFlight - 1;
+  // Bytes allocated in the current region, and how many of those Flush has uploaded.
+  size_t head_ = 0;
+  size_t flushed_ = 0;
+};
+
+#endif // LEARNOPENGL_RING_BUFFER_H
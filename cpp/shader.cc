@@ -1,16 +1,159 @@
 #include "shader.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
 #include <glm/gtc/type_ptr.hpp>
+#include <initializer_list>
 #include <iostream>
 #include <sstream>
+#include <vector>
 
 #include "common.h"
 #include "opengl.h"
 
-namespace {}
+namespace {
 
-Shader::Shader(const char *vertexPath, const char *fragmentPath) {
+// Header of a cached program binary. The key is repeated so that a stale or foreign file is never
+// handed to the driver.
+struct ProgramBinaryHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t key;
+  uint32_t format;
+  uint32_t length;
+};
+
+constexpr char kProgramBinaryMagic[4] = {'L', 'O', 'G', 'L'};
+constexpr uint32_t kProgramBinaryVersion = 1;
+
+// FNV-1a. Each string is followed by a NUL so that ("ab", "c") and ("a", "bc") differ.
+uint64_t hashStrings(std::initializer_list<std::string_view> strings) {
+  uint64_t hash = 14695981039346656037ull;
+  for (std::string_view s : strings) {
+    for (char c : s) {
+      hash = (hash ^ (unsigned char)c) * 1099511628211ull;
+    }
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+std::string_view glString(GLenum name) {
+  const char *s = (const char *)glGetString(name);
+  return s ? s : "";
+}
+
+/**
+ * Returns the directory program binaries are cached in, or an empty path if caching is disabled.
+ * LEARNOPENGL_SHADER_CACHE overrides the default location; setting it to an empty string disables
+ * the cache.
+ */
+std::filesystem::path programCacheDirectory() {
+  // Program binaries need GL 4.1 (or ARB_get_program_binary) and at least one binary format.
+  int formats = 0;
+  if (glGetProgramBinary && glProgramBinary) {
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  }
+  if (formats == 0) {
+    return {};
+  }
+  if (const char *dir = std::getenv("LEARNOPENGL_SHADER_CACHE")) {
+    return dir;
+  }
+  if (const char *dir = std::getenv("XDG_CACHE_HOME")) {
+    return std::filesystem::path(dir) / "learnopengl" / "shaders";
+  }
+  if (const char *home = std::getenv("HOME")) {
+    return std::filesystem::path(home) / ".cache" / "learnopengl" / "shaders";
+  }
+  return {};
+}
+
+bool loadProgramBinary(unsigned int program, const std::filesystem::path &path, uint64_t key) {
+  std::ifstream file(path, std::ios::binary);
+  ProgramBinaryHeader header;
+  if (!file.read((char *)&header, sizeof(header)) ||
+      !std::equal(header.magic, header.magic + 4, kProgramBinaryMagic) ||
+      header.version != kProgramBinaryVersion || header.key != key) {
+    return false;
+  }
+  std::vector<char> binary(header.length);
+  if (!file.read(binary.data(), binary.size())) {
+    return false;
+  }
+  glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+
+  // The driver rejects binaries it cannot use (e.g. after an update), which is not an error here.
+  int success;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  return success;
+}
+
+void storeProgramBinary(unsigned int program, const std::filesystem::path &path, uint64_t key) {
+  int length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  std::vector<char> binary(length);
+  GLenum format;
+  glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+  std::error_code error;
+  std::filesystem::create_directories(path.parent_path(), error);
+  // Write to a temporary file and rename it so that concurrent launches never see a partial file.
+  std::filesystem::path temporary = temporaryPathFor(path.string());
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    ProgramBinaryHeader header = {{}, kProgramBinaryVersion, key, format, (uint32_t)length};
+    std::copy(kProgramBinaryMagic, kProgramBinaryMagic + 4, header.magic);
+    file.write((const char *)&header, sizeof(header));
+    file.write(binary.data(), binary.size());
+    if (!file) {
+      std::cerr << "Warning: failed to write program binary cache " << temporary << std::endl;
+      file.close();
+      std::filesystem::remove(temporary, error);
+      return;
+    }
+  }
+  std::filesystem::rename(temporary, path, error);
+  if (error) {
+    std::filesystem::remove(temporary, error);
+  }
+}
+
+// From KHR_parallel_shader_compile (same values as the ARB extension), which glad does not load.
+constexpr GLenum kCompletionStatus = 0x91B1;
+typedef void(APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+
+bool parallelCompileSupported() {
+  static const bool supported = [] {
+    const char *setThreads = nullptr;
+    if (hasExtension("GL_KHR_parallel_shader_compile")) {
+      setThreads = "glMaxShaderCompilerThreadsKHR";
+    } else if (hasExtension("GL_ARB_parallel_shader_compile")) {
+      setThreads = "glMaxShaderCompilerThreadsARB";
+    } else {
+      return false;
+    }
+    // Some drivers only compile in the background once a thread count has been set. 0xFFFFFFFF
+    // lets the driver choose.
+    auto maxShaderCompilerThreads =
+        (PFNGLMAXSHADERCOMPILERTHREADSPROC)glfwGetProcAddress(setThreads);
+    if (maxShaderCompilerThreads) {
+      maxShaderCompilerThreads(0xFFFFFFFF);
+    }
+    return true;
+  }();
+  return supported;
+}
+
+} // namespace
+
+Shader::Shader(const char *vertexPath, const char *fragmentPath, Compilation compilation) {
   // !. Retrieve the vertex/fragment source code from filePath.
   std::string vertexCode, fragmentCode;
   std::ifstream vShaderFile, fShaderFile;
@@ -39,17 +182,55 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath) {
     exit(EXIT_FAILURE);
   }
 
+  ID = glCreateProgram();
+
+  // Programs are cached per source and per driver, since binaries are not portable across either.
+  std::filesystem::path cacheDirectory = programCacheDirectory();
+  uint64_t cacheKey = hashStrings({vertexCode, fragmentCode, glString(GL_VENDOR),
+                                   glString(GL_RENDERER), glString(GL_VERSION)});
+  std::filesystem::path cachePath;
+  if (!cacheDirectory.empty()) {
+    std::ostringstream name;
+    name << std::hex << cacheKey << ".bin";
+    cachePath = cacheDirectory / name.str();
+    if (loadProgramBinary(ID, cachePath, cacheKey)) {
+      cacheUniformLocations();
+      return;
+    }
+  }
+
+  if (compilation == kAsync) {
+    // Called for its side effect of enabling background compilation.
+    parallelCompileSupported();
+  }
+
   const char *vShaderCode = vertexCode.c_str();
   const char *fShaderCode = fragmentCode.c_str();
 
-  // 2. Compiler shaders.
-  unsigned int vertex = createShader(vShaderCode, GL_VERTEX_SHADER, "vertex shader");
-  unsigned int fragment = createShader(fShaderCode, GL_FRAGMENT_SHADER, "fragment shader");
+  // 2. Compiler shaders. Compile status is only checked in finishLink, so that querying it does
+  // not force the driver to finish one compile before starting the next.
+  unsigned int vertex = compileShader(vShaderCode, GL_VERTEX_SHADER);
+  unsigned int fragment = compileShader(fShaderCode, GL_FRAGMENT_SHADER);
 
-  ID = glCreateProgram();
   glAttachShader(ID, vertex);
   glAttachShader(ID, fragment);
+  if (!cachePath.empty()) {
+    glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
   glLinkProgram(ID);
+  pending_ = PendingLink{vertex, fragment, cachePath.string(), cacheKey};
+
+  if (compilation == kBlocking) {
+    finishLink();
+  }
+}
+
+void Shader::finishLink() const {
+  if (!pending_) {
+    return;
+  }
+  checkShaderCompilationStatus(pending_->vertex, "vertex shader");
+  checkShaderCompilationStatus(pending_->fragment, "fragment shader");
 
   int success;
   glGetProgramiv(ID, GL_LINK_STATUS, &success);
@@ -57,26 +238,105 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath) {
     char infoLog[512];
     glGetProgramInfoLog(ID, 512, nullptr, infoLog);
     std::cerr << "Error: shader program linking failed\n" << infoLog << std::endl;
+  } else if (!pending_->cachePath.empty()) {
+    storeProgramBinary(ID, pending_->cachePath, pending_->cacheKey);
+  }
+
+  glDeleteShader(pending_->vertex);
+  glDeleteShader(pending_->fragment);
+  pending_.reset();
+
+  cacheUniformLocations();
+}
+
+bool Shader::isReady() const {
+  if (!pending_ || !parallelCompileSupported()) {
+    return true;
+  }
+  int complete;
+  glGetProgramiv(ID, kCompletionStatus, &complete);
+  return complete;
+}
+
+void Shader::cacheUniformLocations() const {
+  int count = 0, maxLength = 0;
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+  std::vector<char> buffer(std::max(maxLength, 1));
+  std::vector<int> locations;
+  for (int i = 0; i < count; i++) {
+    int length = 0, size = 0;
+    GLenum type;
+    glGetActiveUniform(ID, i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+    std::string name(buffer.data(), length);
+    // Members of uniform blocks have no location.
+    int location = glGetUniformLocation(ID, name.c_str());
+    if (location < 0) {
+      continue;
+    }
+    uniform_names_.push_back(name);
+    locations.push_back(location);
+    // Arrays are reported as "name[0]"; also accept the bare name as GL does, and every other
+    // element, whose locations GL does not promise to be consecutive.
+    if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+      std::string base = name.substr(0, name.size() - 3);
+      uniform_names_.push_back(base);
+      locations.push_back(location);
+      for (int element = 1; element < size; element++) {
+        std::string element_name = base + "[" + std::to_string(element) + "]";
+        int element_location = glGetUniformLocation(ID, element_name.c_str());
+        if (element_location >= 0) {
+          uniform_names_.push_back(std::move(element_name));
+          locations.push_back(element_location);
+        }
+      }
+    }
   }
 
-  glDeleteShader(vertex);
-  glDeleteShader(fragment);
+  for (size_t i = 0; i < uniform_names_.size(); i++) {
+    uniform_locations_.emplace(uniform_names_[i], locations[i]);
+  }
 }
 
-void Shader::use() const { glUseProgram(ID); }
+void Shader::use() const {
+  finishLink();
+  glUseProgram(ID);
+}
 
-void Shader::setBool(const std::string &name, bool value) const {
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+Shader::Uniform Shader::uniform(std::string_view name) const {
+  finishLink();
+  auto it = uniform_locations_.find(name);
+  return it == uniform_locations_.end() ? Uniform{} : Uniform{it->second};
 }
-void Shader::setInt(const std::string &name, int value) const {
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+
+void Shader::bindUniformBlock(std::string_view name, unsigned int binding) const {
+  finishLink();
+  unsigned int index = glGetUniformBlockIndex(ID, std::string(name).c_str());
+  if (index != GL_INVALID_INDEX) {
+    glUniformBlockBinding(ID, index, binding);
+  }
 }
-void Shader::setFloat(const std::string &name, float value) const {
-  glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+
+void Shader::setBool(std::string_view name, bool value) const { setBool(uniform(name), value); }
+void Shader::setInt(std::string_view name, int value) const { setInt(uniform(name), value); }
+void Shader::setFloat(std::string_view name, float value) const { setFloat(uniform(name), value); }
+void Shader::set(std::string_view name, const glm::mat4 &m) const { set(uniform(name), m); }
+
+void Shader::setBool(Uniform uniform, bool value) const {
+  glUniform1i(uniform.location, (int)value);
 }
+void Shader::setInt(Uniform uniform, int value) const { glUniform1i(uniform.location, value); }
+void Shader::setFloat(Uniform uniform, float value) const { glUniform1f(uniform.location, value); }
 
-void Shader::set(const std::string &name, glm::mat4 &m) const {
-  glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(m));
+void Shader::set(Uniform uniform, const glm::mat4 &m) const {
+  glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(m));
 }
 
-Shader::~Shader() { glDeleteProgram(ID); }
+Shader::~Shader() {
+  if (pending_) {
+    glDeleteShader(pending_->vertex);
+    glDeleteShader(pending_->fragment);
+  }
+  glDeleteProgram(ID);
+}
@@ -1,24 +1,82 @@
 #ifndef LEARNOPENGL_SHADER_H
 #define LEARNOPENGL_SHADER_H
 
+#include <cstdint>
 #include <glm/glm.hpp>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 class Shader {
 public:
+  // A uniform location resolved ahead of time, so per-draw updates skip the name lookup entirely.
+  // A location of -1 is silently ignored by glUniform*, matching glGetUniformLocation semantics.
+  struct Uniform {
+    int location = -1;
+  };
+
+  enum Compilation {
+    // Compile and link before the constructor returns.
+    kBlocking,
+    // Submit compile and link work and return immediately; the first use() or uniform() waits for
+    // it. Constructing several programs this way lets the driver compile them in parallel.
+    kAsync,
+  };
+
   // The program ID.
   unsigned int ID;
 
-  Shader(const char *vertexPath, const char *fragmentPath);
+  Shader(const char *vertexPath, const char *fragmentPath, Compilation compilation = kBlocking);
+  Shader(const Shader &) = delete;
+  Shader &operator=(const Shader &) = delete;
   ~Shader();
 
   // Activate the shader.
   void use() const;
 
-  void setBool(const std::string &name, bool value) const;
-  void setInt(const std::string &name, int value) const;
-  void setFloat(const std::string &name, float value) const;
-  void set(const std::string &name, glm::mat4 &m) const;
+  // Whether the program has finished linking, i.e. use() will not block. This can only be answered
+  // without blocking when the driver supports KHR_parallel_shader_compile; otherwise it is true.
+  bool isReady() const;
+
+  // Looks up an active uniform in the table built at link time. Arrays are also registered under
+  // their base name, which refers to element 0.
+  Uniform uniform(std::string_view name) const;
+
+  void setBool(std::string_view name, bool value) const;
+  void setInt(std::string_view name, int value) const;
+  void setFloat(std::string_view name, float value) const;
+  void set(std::string_view name, const glm::mat4 &m) const;
+
+  // Sources the named uniform block from whatever range is bound to binding with
+  // glBindBufferRange(GL_UNIFORM_BUFFER, ...). Unknown names are ignored.
+  void bindUniformBlock(std::string_view name, unsigned int binding) const;
+
+  void setBool(Uniform uniform, bool value) const;
+  void setInt(Uniform uniform, int value) const;
+  void setFloat(Uniform uniform, float value) const;
+  void set(Uniform uniform, const glm::mat4 &m) const;
+
+private:
+  // Compile and link work that has been submitted but whose result has not been checked yet.
+  struct PendingLink {
+    unsigned int vertex;
+    unsigned int fragment;
+    std::string cachePath;
+    uint64_t cacheKey;
+  };
+
+  // Waits for a pending link, reports errors and builds the uniform table.
+  void finishLink() const;
+  void cacheUniformLocations() const;
+
+  // Linking is finished lazily from const accessors, hence mutable.
+  mutable std::optional<PendingLink> pending_;
+  // Names of the active uniforms. The keys of uniform_locations_ point into these strings, so the
+  // vector must not change once the table is built.
+  mutable std::vector<std::string> uniform_names_;
+  mutable std::unordered_map<std::string_view, int> uniform_locations_;
 };
 
 #endif // LEARNOPENGL_SHADER_H
@@ -0,0 +1,154 @@
+#ifndef LEARNOPENGL_STATIC_BATCHER_H
+#define LEARNOPENGL_STATIC_BATCHER_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <map>
+#include <set>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "instance_buffer.h"
+#include "mesh_pool.h"
+#include "mesh_processing.h"
+
+/**
+ * Merges objects that never move into one mesh per material, transformed into world space once,
+ * so that each material costs a single draw call however many objects use it. Objects are added
+ * and removed freely; Update rebuilds only the batches whose objects changed.
+ *
+ * Vertex needs a glm::vec3 position member, and any glm::vec3 normal member is transformed too.
+ * The batches live in one MeshPool and are drawn with an identity model matrix, so they work with
+ * shaders written for instanced objects.
+ */
+template <typename Vertex>
+class StaticBatcher {
+public:
+  /** Where one object's triangles ended up in its batch, relative to the batch's first index. */
+  struct BatchObject {
+    uint32_t id;
+    IndexRange indices;
+  };
+
+  struct Batch {
+    uint32_t material;
+    PooledMesh mesh;
+    // In id order, so drawing a subset of them, such as those not culled, is a list of ranges.
+    std::vector<BatchObject> objects;
+  };
+
+  StaticBatcher(uint32_t vertex_capacity, uint32_t index_capacity)
+      : pool_(vertex_capacity, index_capacity) {
+    glm::mat4 identity(1.0f);
+    identity_.Upload(&identity, 1);
+    identity_.Attach(pool_.Vao());
+  }
+
+  /**
+   * Adds an instance of mesh, which is not copied: every Update that rebuilds the material's batch
+   * reads it again, so it must stay alive until the object is removed. Returns an id for Remove.
+   */
+  uint32_t Add(const IndexedMesh<Vertex> &mesh, const glm::mat4 &model, uint32_t material) {
+    uint32_t id = next_id_++;
+    objects_[id] = {&mesh, model, material};
+    dirty_.insert(material);
+    return id;
+  }
+
+  void Remove(uint32_t id) {
+    auto it = objects_.find(id);
+    if (it != objects_.end()) {
+      dirty_.insert(it->second.material);
+      objects_.erase(it);
+    }
+  }
+
+  /** Rebuilds changed batches. Returns false if one no longer fits in the pool. */
+  bool Update() {
+    bool fits = true;
+    for (uint32_t material : dirty_) {
+      auto batch = batches_.find(material);
+      if (batch != batches_.end()) {
+        pool_.Remove(batch->second.mesh);
+        batches_.erase(batch);
+      }
+      std::vector<BatchObject> objects;
+      IndexedMesh<Vertex> merged = Merge(material, &objects);
+      if (merged.indices.empty()) {
+        continue;
+      }
+      if (std::optional<PooledMesh> mesh = pool_.Add(merged)) {
+        batches_[material] = {material, *mesh, std::move(objects)};
+      } else {
+        fits = false;
+      }
+    }
+    dirty_.clear();
+    return fits;
+  }
+
+  /** The batches by material, as of the last Update. */
+  const std::map<uint32_t, Batch> &Batches() const { return batches_; }
+
+  /** The pool holding the batches, for drawing them some other way, such as from a RenderQueue. */
+  const MeshPool<Vertex> &Pool() const { return pool_; }
+
+  /** Binds the shared vertex array, after which Draw(batch) may be called for each batch. */
+  void Bind() const { pool_.Bind(); }
+  void Draw(const Batch &batch, GLenum mode = GL_TRIANGLES) const { pool_.Draw(batch.mesh, mode); }
+
+private:
+  template <typename T, typename = void>
+  struct HasNormal : std::false_type {};
+  template <typename T>
+  struct HasNormal<T, std::void_t<decltype(T::normal)>>
+      : std::is_same<decltype(T::normal), glm::vec3> {};
+
+  struct Object {
+    const IndexedMesh<Vertex> *mesh;
+    glm::mat4 model;
+    uint32_t material;
+  };
+
+  IndexedMesh<Vertex> Merge(uint32_t material, std::vector<BatchObject> *objects) const {
+    IndexedMesh<Vertex> merged;
+    for (const auto &[id, object] : objects_) {
+      if (object.material != material) {
+        continue;
+      }
+      objects->push_back({id, {(uint32_t)merged.indices.size(),
+                               (uint32_t)object.mesh->indices.size()}});
+      uint32_t base = (uint32_t)merged.vertices.size();
+      glm::mat3 linear(object.model);
+      glm::mat3 normal_matrix = glm::transpose(glm::inverse(linear));
+      for (Vertex vertex : object.mesh->vertices) {
+        vertex.position = glm::vec3(object.model * glm::vec4(vertex.position, 1.0f));
+        if constexpr (HasNormal<Vertex>::value) {
+          vertex.normal = glm::normalize(normal_matrix * vertex.normal);
+        }
+        merged.vertices.push_back(vertex);
+      }
+      for (uint32_t index : object.mesh->indices) {
+        merged.indices.push_back(base + index);
+      }
+      // A mirroring transform turns triangles inside out; swapping two corners turns them back.
+      if (glm::determinant(linear) < 0.0f) {
+        for (size_t i = merged.indices.size() - object.mesh->indices.size();
+             i + 2 < merged.indices.size(); i += 3) {
+          std::swap(merged.indices[i + 1], merged.indices[i + 2]);
+        }
+      }
+    }
+    return merged;
+  }
+
+  MeshPool<Vertex> pool_;
+  InstanceBuffer identity_;
+  std::map<uint32_t, Object> objects_;
+  std::map<uint32_t, Batch> batches_;
+  std::set<uint32_t> dirty_;
+  uint32_t next_id_ = 0;
+};
+
+#endif // LEARNOPENGL_STATIC_BATCHER_H
@@ -0,0 +1,203 @@
+#include "texture_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "block_compression.h"
+#include "common.h"
+#include "mapped_file.h"
+#include "opengl.h"
+#include "third_party/stb_image.h"
+
+namespace {
+
+const GLenum kFormats[] = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
+const GLenum kInternalFormats[] = {GL_R8, GL_RG8, GL_RGB8, GL_RGBA8};
+// Larger than any GL implementation's limit, so anything above it is a corrupt header.
+constexpr uint32_t kMaxTextureSize = 64 * 1024;
+
+uint64_t alignUp(uint64_t offset) {
+  return (offset + kTextureFileAlignment - 1) / kTextureFileAlignment * kTextureFileAlignment;
+}
+
+// The bytes a width x height level holds in the header's format, or 0 for an unknown format.
+uint64_t levelSize(const TextureFileHeader &header, uint32_t width, uint32_t height) {
+  if (header.format == 0) {
+    if (header.internal_format == BlockInternalFormat(BlockFormat::kBC1)) {
+      return CompressedImageSize(BlockFormat::kBC1, width, height);
+    }
+    if (header.internal_format == BlockInternalFormat(BlockFormat::kBC3)) {
+      return CompressedImageSize(BlockFormat::kBC3, width, height);
+    }
+    return 0;
+  }
+  for (uint64_t channels = 1; channels <= 4; channels++) {
+    if (header.format == kFormats[channels - 1] &&
+        header.internal_format == kInternalFormats[channels - 1]) {
+      return (uint64_t)width * height * channels;
+    }
+  }
+  return 0;
+}
+
+bool writeTextureFile(const std::string &path, TextureFileHeader header,
+                      const std::vector<std::vector<unsigned char>> &levels,
+                      const std::vector<std::pair<int, int>> &sizes) {
+  std::copy(kTextureFileMagic, kTextureFileMagic + 4, header.magic);
+  header.version = kTextureFileVersion;
+  header.levels = levels.size();
+
+  std::vector<TextureFileLevel> table(levels.size());
+  uint64_t offset = alignUp(sizeof(header) + table.size() * sizeof(TextureFileLevel));
+  for (size_t i = 0; i < levels.size(); i++) {
+    table[i] = {(uint32_t)sizes[i].first, (uint32_t)sizes[i].second, offset, levels[i].size()};
+    offset = alignUp(offset + levels[i].size());
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write((const char *)&header, sizeof(header));
+  file.write((const char *)table.data(), table.size() * sizeof(TextureFileLevel));
+  const char padding[kTextureFileAlignment] = {};
+  for (size_t i = 0; i < levels.size(); i++) {
+    file.write(padding, table[i].offset - file.tellp());
+    file.write((const char *)levels[i].data(), levels[i].size());
+  }
+  if (!file) {
+    std::cerr << "Error: failed to write " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+TextureImage DownsampleImage(const TextureImage &image) {
+  TextureImage result;
+  result.width = std::max(1, image.width / 2);
+  result.height = std::max(1, image.height / 2);
+  result.channels = image.channels;
+  result.pixels.resize((size_t)result.width * result.height * result.channels);
+
+  auto at = [&](int x, int y, int c) {
+    x = std::min(x, image.width - 1);
+    y = std::min(y, image.height - 1);
+    return (int)image.pixels[((size_t)y * image.width + x) * image.channels + c];
+  };
+  for (int y = 0; y < result.height; y++) {
+    for (int x = 0; x < result.width; x++) {
+      for (int c = 0; c < image.channels; c++) {
+        int sum = at(2 * x, 2 * y, c) + at(2 * x + 1, 2 * y, c) + at(2 * x, 2 * y + 1, c) +
+                  at(2 * x + 1, 2 * y + 1, c);
+        result.pixels[((size_t)y * result.width + x) * result.channels + c] = (sum + 2) / 4;
+      }
+    }
+  }
+  return result;
+}
+
+bool CookTexture(const std::string &image_path, const std::string &output_path,
+                 const CookTextureOptions &options) {
+  TextureImage image;
+  stbi_set_flip_vertically_on_load_thread(options.flip_vertically);
+  unsigned char *pixels =
+      stbi_load(image_path.c_str(), &image.width, &image.height, &image.channels, 0);
+  if (!pixels) {
+    std::cerr << "Error: failed to load " << image_path << ": " << stbi_failure_reason()
+              << std::endl;
+    return false;
+  }
+  image.pixels.assign(pixels, pixels + (size_t)image.width * image.height * image.channels);
+  stbi_image_free(pixels);
+
+  TextureFileHeader header = {};
+  header.width = image.width;
+  header.height = image.height;
+  header.internal_format = kInternalFormats[image.channels - 1];
+  header.format = kFormats[image.channels - 1];
+
+  bool compress = options.compress && image.channels != 2;
+  BlockFormat block_format = BlockFormatFor(image);
+  if (compress) {
+    header.internal_format = BlockInternalFormat(block_format);
+    header.format = 0;
+  }
+
+  std::vector<std::vector<unsigned char>> levels;
+  std::vector<std::pair<int, int>> sizes;
+  for (;;) {
+    sizes.emplace_back(image.width, image.height);
+    bool last = !options.generate_mipmaps || (image.width == 1 && image.height == 1);
+    TextureImage next = last ? TextureImage() : DownsampleImage(image);
+    levels.push_back(compress ? CompressImage(image, block_format) : std::move(image.pixels));
+    if (last) {
+      break;
+    }
+    image = std::move(next);
+  }
+  return writeTextureFile(output_path, header, levels, sizes);
+}
+
+unsigned int LoadTextureFile(const std::string &path) {
+  std::unique_ptr<MappedFile> file = MappedFile::Open(path);
+  if (!file) {
+    return 0;
+  }
+
+  TextureFileHeader header;
+  const TextureFileLevel *levels = nullptr;
+  bool valid = file->Size() >= sizeof(header);
+  if (valid) {
+    std::memcpy(&header, file->Data(), sizeof(header));
+    valid = std::equal(header.magic, header.magic + 4, kTextureFileMagic) &&
+            header.version == kTextureFileVersion && header.levels > 0 && header.levels <= 32 &&
+            sizeof(header) + header.levels * sizeof(TextureFileLevel) <= file->Size();
+  }
+  if (valid) {
+    levels = reinterpret_cast<const TextureFileLevel *>(file->Data() + sizeof(header));
+    valid = header.width > 0 && header.height > 0 && header.width <= kMaxTextureSize &&
+            header.height <= kMaxTextureSize;
+    // GL reads as many bytes as each level's size and format call for, so the table has to agree
+    // with both, and with the mapping, before anything is uploaded.
+    for (uint32_t i = 0; valid && i < header.levels; i++) {
+      uint32_t width = std::max(1u, header.width >> i), height = std::max(1u, header.height >> i);
+      valid = levels[i].width == width && levels[i].height == height &&
+              levels[i].size == levelSize(header, width, height) && levels[i].size > 0 &&
+              levels[i].offset <= file->Size() &&
+              levels[i].size <= file->Size() - levels[i].offset;
+    }
+  }
+  if (!valid) {
+    std::cerr << "Error: " << path << " is not a valid texture file" << std::endl;
+    return 0;
+  }
+  if (header.format == 0 && !hasExtension("GL_EXT_texture_compression_s3tc")) {
+    std::cerr << "Error: " << path << " is S3TC compressed, which this context does not support"
+              << std::endl;
+    return 0;
+  }
+
+  unsigned int texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.levels - 1);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (uint32_t i = 0; i < header.levels; i++) {
+    const unsigned char *data = file->Data() + levels[i].offset;
+    if (header.format == 0) {
+      glCompressedTexImage2D(GL_TEXTURE_2D, i, header.internal_format, levels[i].width,
+                             levels[i].height, 0, levels[i].size, data);
+    } else {
+      glTexImage2D(GL_TEXTURE_2D, i, header.internal_format, levels[i].width, levels[i].height, 0,
+                   header.format, GL_UNSIGNED_BYTE, data);
+    }
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return texture;
+}
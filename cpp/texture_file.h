@@ -0,0 +1,70 @@
+#ifndef LEARNOPENGL_TEXTURE_FILE_H
+#define LEARNOPENGL_TEXTURE_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Layout of a cooked texture file (.tex), as written by the cook_texture tool. The header and a
+ * table of mip levels are followed by the level data, each level starting on a
+ * kTextureFileAlignment boundary. Levels are stored exactly as GL consumes them, so a memory
+ * mapping of the file can be uploaded without any decoding.
+ */
+struct TextureFileHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t levels;
+  uint32_t internal_format; // GL_RGBA8 etc., or a compressed format.
+  uint32_t format;          // Pixel transfer format; zero for compressed data.
+  uint32_t reserved;
+};
+
+struct TextureFileLevel {
+  uint32_t width;
+  uint32_t height;
+  uint64_t offset; // From the start of the file.
+  uint64_t size;
+};
+
+constexpr char kTextureFileMagic[4] = {'L', 'T', 'E', 'X'};
+constexpr uint32_t kTextureFileVersion = 1;
+constexpr uint64_t kTextureFileAlignment = 16;
+
+/** An uncompressed 8-bit image with 1 to 4 interleaved channels. */
+struct TextureImage {
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  std::vector<unsigned char> pixels;
+};
+
+struct CookTextureOptions {
+  bool flip_vertically = false;
+  bool generate_mipmaps = true;
+  // Store BC1 (opaque) or BC3 (with alpha) blocks instead of raw pixels. Two-channel images are
+  // always stored uncompressed.
+  bool compress = false;
+};
+
+/** Halves an image in each dimension (down to 1) with a box filter. */
+TextureImage DownsampleImage(const TextureImage &image);
+
+/**
+ * Decodes image_path and writes it, with its mip chain, to output_path in the format above. Errors
+ * are reported on stderr.
+ */
+bool CookTexture(const std::string &image_path, const std::string &output_path,
+                 const CookTextureOptions &options);
+
+/**
+ * Maps a cooked texture file and uploads every level straight from the mapping into a new texture.
+ * Returns 0 if the file cannot be opened (silently, so callers can fall back to the source image),
+ * is not a valid texture file, or is compressed in a format the context does not support (both
+ * reported on stderr).
+ */
+unsigned int LoadTextureFile(const std::string &path);
+
+#endif // LEARNOPENGL_TEXTURE_FILE_H
@@ -0,0 +1,186 @@
+#include "texture_loader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "block_compression.h"
+#include "common.h"
+#include "opengl.h"
+#include "third_party/stb_image.h"
+
+TextureLoader::TextureLoader(unsigned int threads, bool compress)
+    : compress_(compress && hasExtension("GL_EXT_texture_compression_s3tc")) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (unsigned int i = 0; i < threads; i++) {
+    workers_.emplace_back([this]() { DecodeRequests(); });
+  }
+  glGenBuffers(1, &pixel_buffer_);
+}
+
+TextureLoader::~TextureLoader() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    requests_.clear();
+  }
+  requested_.notify_all();
+  for (std::thread &worker : workers_) {
+    worker.join();
+  }
+  for (const Image &image : images_) {
+    stbi_image_free(image.pixels);
+  }
+  glDeleteBuffers(1, &pixel_buffer_);
+}
+
+unsigned int TextureLoader::Load(const std::string &path, bool flip_vertically) {
+  unsigned int texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  // A 1x1 texture is mipmap complete on its own, so the placeholder samples correctly.
+  const unsigned char placeholder[4] = {255, 255, 255, 255};
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    requests_.push_back({texture, path, flip_vertically});
+  }
+  requested_.notify_one();
+  in_flight_++;
+  return texture;
+}
+
+size_t TextureLoader::Update() {
+  std::vector<Image> images;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    images.swap(images_);
+  }
+  for (const Image &image : images) {
+    Upload(image);
+    stbi_image_free(image.pixels);
+  }
+  in_flight_ -= images.size();
+  return in_flight_;
+}
+
+void TextureLoader::Finish() {
+  while (in_flight_ > 0) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      decoded_.wait(lock, [this]() { return !images_.empty(); });
+    }
+    Update();
+  }
+}
+
+void TextureLoader::DecodeRequests() {
+  for (;;) {
+    Request request;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      requested_.wait(lock, [this]() { return stopping_ || !requests_.empty(); });
+      if (stopping_) {
+        return;
+      }
+      request = std::move(requests_.front());
+      requests_.pop_front();
+    }
+
+    // The flip flag is otherwise global to stb_image, which would race between workers.
+    stbi_set_flip_vertically_on_load_thread(request.flip_vertically);
+    Image image = {request.texture, std::move(request.path), 0, 0, 0, nullptr, 0, {}};
+    image.pixels = stbi_load(image.path.c_str(), &image.width, &image.height, &image.channels, 0);
+    if (compress_ && image.pixels && image.channels != 2) {
+      Compress(image);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      images_.push_back(std::move(image));
+    }
+    decoded_.notify_one();
+  }
+}
+
+void TextureLoader::Compress(Image &image) const {
+  TextureImage level;
+  level.width = image.width;
+  level.height = image.height;
+  level.channels = image.channels;
+  level.pixels.assign(image.pixels,
+                      image.pixels + (size_t)image.width * image.height * image.channels);
+  stbi_image_free(image.pixels);
+  image.pixels = nullptr;
+
+  // glGenerateMipmap cannot produce compressed levels, so the whole chain is built here. Workers
+  // already run in parallel across images, so each encodes on its own thread only.
+  BlockFormat format = BlockFormatFor(level);
+  image.compressed_format = BlockInternalFormat(format);
+  for (;;) {
+    image.levels.push_back({level.width, level.height, CompressImage(level, format, 1)});
+    if (level.width == 1 && level.height == 1) {
+      break;
+    }
+    level = DownsampleImage(level);
+  }
+}
+
+const void *TextureLoader::Stage(const void *data, size_t size) {
+  // Orphan the previous contents so that writing never waits on an upload still in progress, then
+  // let the driver copy out of the buffer asynchronously instead of from client memory.
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer_);
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+  void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (!mapped) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return data;
+  }
+  std::memcpy(mapped, data, size);
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  return nullptr;
+}
+
+void TextureLoader::Upload(const Image &image) {
+  if (!image.pixels && image.levels.empty()) {
+    std::cout << "Failed to load texture " << image.path << std::endl;
+    return;
+  }
+  glBindTexture(GL_TEXTURE_2D, image.texture);
+
+  if (!image.levels.empty()) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (int)image.levels.size() - 1);
+    for (size_t i = 0; i < image.levels.size(); i++) {
+      const CompressedLevel &level = image.levels[i];
+      const void *blocks = Stage(level.blocks.data(), level.blocks.size());
+      glCompressedTexImage2D(GL_TEXTURE_2D, (int)i, image.compressed_format, level.width,
+                             level.height, 0, (GLsizei)level.blocks.size(), blocks);
+    }
+  } else {
+    static const GLenum kFormats[] = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
+    static const GLenum kInternalFormats[] = {GL_R8, GL_RG8, GL_RGB8, GL_RGBA8};
+    GLenum format = kFormats[image.channels - 1];
+    GLenum internal_format = kInternalFormats[image.channels - 1];
+    size_t size = (size_t)image.width * image.height * image.channels;
+
+    const void *pixels = Stage(image.pixels, size);
+    // Rows of RGB images are not necessarily 4-byte aligned.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, internal_format, image.width, image.height, 0, format,
+                 GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+  }
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
@@ -0,0 +1,82 @@
+#ifndef LEARNOPENGL_TEXTURE_LOADER_H
+#define LEARNOPENGL_TEXTURE_LOADER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Loads 2D textures from image files on a pool of worker threads.
+ *
+ * Load() returns a texture name straight away, holding a 1x1 placeholder so that it can be bound
+ * immediately. Workers decode the image files in the background; Update(), called on the GL
+ * thread, then streams the decoded pixels into their textures through a pixel buffer object and
+ * generates mipmaps. The caller owns the returned textures.
+ *
+ * With compression enabled, and if the context supports S3TC, workers also build the mip chain
+ * and encode every level to BC1/BC3 before upload, cutting texture memory by 4-6x.
+ */
+class TextureLoader {
+public:
+  // Zero threads means one per hardware thread.
+  explicit TextureLoader(unsigned int threads = 0, bool compress = false);
+  TextureLoader(const TextureLoader &) = delete;
+  TextureLoader &operator=(const TextureLoader &) = delete;
+  ~TextureLoader();
+
+  unsigned int Load(const std::string &path, bool flip_vertically = false);
+
+  /** Uploads every image decoded since the last call. Returns the number still in flight. */
+  size_t Update();
+
+  /** Blocks until every texture requested so far has been uploaded. */
+  void Finish();
+
+private:
+  struct Request {
+    unsigned int texture;
+    std::string path;
+    bool flip_vertically;
+  };
+
+  struct CompressedLevel {
+    int width, height;
+    std::vector<unsigned char> blocks;
+  };
+
+  struct Image {
+    unsigned int texture;
+    std::string path;
+    int width, height, channels;
+    unsigned char *pixels; // Owned; freed with stbi_image_free. Null if decoding failed.
+    // Set instead of pixels when the image was block compressed.
+    unsigned int compressed_format;
+    std::vector<CompressedLevel> levels;
+  };
+
+  void DecodeRequests();
+  void Compress(Image &image) const;
+  void Upload(const Image &image);
+  // Copies data into the pixel buffer, which is left bound. Returns the pointer to pass to
+  // glTexImage2D and friends: an offset into the buffer, or data itself if mapping failed.
+  const void *Stage(const void *data, size_t size);
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable requested_;
+  std::condition_variable decoded_;
+  // Guarded by mutex_.
+  std::deque<Request> requests_;
+  std::vector<Image> images_;
+  bool stopping_ = false;
+  bool compress_;
+
+  // Only touched on the GL thread.
+  size_t in_flight_ = 0;
+  unsigned int pixel_buffer_ = 0;
+};
+
+#endif // LEARNOPENGL_TEXTURE_LOADER_H
@@ -1,14 +1,37 @@
 #include "common.h"
+#include "mesh.h"
 #include "shader.h"
-#include "third_party/stb_image.h"
+#include "texture_file.h"
+#include "texture_loader.h"
+#include "vertex_quantization.h"
+#include <iterator>
+
+// Source data, packed into PackedVertex before upload.
+struct Vertex {
+  glm::vec3 position;
+  glm::vec3 color;
+  glm::vec2 tex_coord;
+};
+
+// Half-float positions, so no dequantization is needed: 16 bytes per vertex instead of 32.
+struct PackedVertex {
+  Half4 position;
+  Unorm8x4 color;
+  Unorm16x2 tex_coord;
+
+  static constexpr std::array<VertexAttribute, 3> Layout() {
+    return {VERTEX_ATTRIBUTE(PackedVertex, position, 0), VERTEX_ATTRIBUTE(PackedVertex, color, 1),
+            VERTEX_ATTRIBUTE(PackedVertex, tex_coord, 2)};
+  }
+};
 
 // clang-format off
-float vertices[] = {
-    // positions          // colors           // texture coords
-     0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f,   // top right
-     0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f,   // bottom right
-    -0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f,   // bottom left
-    -0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f    // top left
+Vertex vertices[] = {
+    // positions             // colors              // texture coords
+    {{ 0.5f,  0.5f,  0.0f},  { 1.0f,  0.0f,  0.0f},  { 1.0f,  1.0f}},   // top right
+    {{ 0.5f, -0.5f,  0.0f},  { 0.0f,  1.0f,  0.0f},  { 1.0f,  0.0f}},   // bottom right
+    {{-0.5f, -0.5f,  0.0f},  { 0.0f,  0.0f,  1.0f},  { 0.0f,  0.0f}},   // bottom left
+    {{-0.5f,  0.5f,  0.0f},  { 1.0f,  1.0f,  0.0f},  { 0.0f,  1.0f}}   // top left
 };
 
 unsigned int indices[] = {
@@ -18,96 +41,37 @@ unsigned int indices[] = {
 };
 // clang-format on
 
-void setupVertexArrayObject(unsigned int &VAO, unsigned int &VBO, unsigned int &EBO) {
-  glGenVertexArrays(1, &VAO);
-  glGenBuffers(1, &VBO);
-  glGenBuffers(1, &EBO);
-
-  // 1. Bind Vertex Array Object.
-  glBindVertexArray(VAO);
-
-  // 2. Copy our vertices array into a buffer for OpenGL to use.
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-  // Copy our index array into an element buffer for OpenGL to use.
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-  // 3. Then set our vertex attribute pointers.
-  // Position attribute:
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), nullptr);
-  glEnableVertexAttribArray(0);
-  // Color attribute:
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float)));
-  glEnableVertexAttribArray(1);
-  // Texture attribute:
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(6 * sizeof(float)));
-  glEnableVertexAttribArray(2);
-
-  // Unbind the VBO. Note that this is allowed, the call to glVertexAttribPointer registered VBO
-  // as the vertex attribute's bound vertex buffer object so afterwards we can safely unbind.
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Unbind the VAO. You can unbind the VAO afterwards so other VAO calls won't accidentally
-  // modify this VAO, but this rarely happens. Modifying other VAOs requires a call to
-  // glBindVertexArray anyway, so we generally don't unbind VAOs (nor VBOs) when it's not
-  // directly necessary.
-  glBindVertexArray(0);
-
-  // Unbind the EBO. This must come after unbinding the VAO since a bound VAO stores binds and
-  // unbinds of GL_ELEMENT_ARRAY_BUFFER.
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-}
-
-int main() {
-  auto app = GlfwApplication::Create();
+int main(int argc, char **argv) {
+  auto app = GlfwApplication::Create(GlfwApplication::ParseOptions(argc, argv));
 
   Shader shader("/Users/kal/Code/learnopengl/vertex_shader.glsl",
                 "/Users/kal/Code/learnopengl/fragment_shader.glsl");
 
-  unsigned int texture1;
-  glGenTextures(1, &texture1);
-  glBindTexture(GL_TEXTURE_2D, texture1);
-  // set the texture wrapping/filtering options (on the currently bound texture object)
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  // load and generate the texture
-  int width, height, nrChannels;
-  unsigned char *data =
-      stbi_load("/Users/kal/Code/learnopengl/container.jpeg", &width, &height, &nrChannels, 0);
-  if (data) {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-  } else {
-    std::cout << "Failed to load container texture" << std::endl;
+  // Prefer textures precooked with cook_texture, which upload straight from a file mapping.
+  // Otherwise decode the source images in the background; they show a placeholder until Update()
+  // uploads them.
+  TextureLoader loader;
+  unsigned int texture1 = LoadTextureFile("/Users/kal/Code/learnopengl/container.tex");
+  if (texture1 == 0) {
+    texture1 = loader.Load("/Users/kal/Code/learnopengl/container.jpeg");
   }
-  stbi_image_free(data);
-
-  unsigned int texture2;
-  glGenTextures(1, &texture2);
-  glBindTexture(GL_TEXTURE_2D, texture2);
-  // set the texture wrapping/filtering options (on the currently bound texture object)
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  stbi_set_flip_vertically_on_load(true);
-  data = stbi_load("/Users/kal/Code/learnopengl/awesomeface.png", &width, &height, &nrChannels, 0);
-  if (data) {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-  } else {
-    std::cout << "Failed to load awesomeface texture" << std::endl;
+  unsigned int texture2 = LoadTextureFile("/Users/kal/Code/learnopengl/awesomeface.tex");
+  if (texture2 == 0) {
+    texture2 = loader.Load("/Users/kal/Code/learnopengl/awesomeface.png", /*flip_vertically=*/true);
   }
-  stbi_image_free(data);
 
-  unsigned int VAO, VBO, EBO;
-  setupVertexArrayObject(VAO, VBO, EBO);
+  PackedVertex packed[std::size(vertices)];
+  EncodePositions(&vertices[0].position, sizeof(Vertex), std::size(vertices), &packed[0].position,
+                  sizeof(PackedVertex));
+  EncodeColors(&vertices[0].color, sizeof(Vertex), std::size(vertices), &packed[0].color,
+               sizeof(PackedVertex));
+  EncodeTexCoords(&vertices[0].tex_coord, sizeof(Vertex), std::size(vertices),
+                  &packed[0].tex_coord, sizeof(PackedVertex));
+  Mesh<PackedVertex> quad(packed, std::size(packed), indices, std::size(indices));
 
   app->Run([&]() {
+    loader.Update();
+
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
@@ -121,13 +85,11 @@ int main() {
     glUniform1i(glGetUniformLocation(shader.ID, "texture1"), 0);
     shader.setInt("texture2", 1);
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+    quad.Draw();
 
     glBindVertexArray(0);
   });
 
-  glDeleteVertexArrays(1, &VAO);
-  glDeleteBuffers(1, &VBO);
+  glDeleteTextures(1, &texture1);
+  glDeleteTextures(1, &texture2);
 }
\ No newline at end of file
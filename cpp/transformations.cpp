@@ -1,58 +1,40 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/transform.hpp>
+#include <iostream>
+#include <optional>
+#include <vector>
 
+#include "bvh.h"
 #include "camera.h"
 #include "common.h"
+#include "draw_list.h"
+#include "mesh_lod.h"
+#include "mesh_processing.h"
+#include "procedural_geometry.h"
+#include "render_queue.h"
+#include "ring_buffer.h"
 #include "shader.h"
-#include "third_party/stb_image.h"
-
-// clang-format off
-float vertices[] = {
-    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-     0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
-     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-     0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-    -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-
-    -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-    -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-    -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-     0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-     0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-     0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-     0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
-     0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-     0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-
-    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-    -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
-    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f
+#include "static_batcher.h"
+#include "texture_file.h"
+#include "texture_loader.h"
+
+// The Frame uniform block of vertex_shader.glsl, in std140 layout.
+struct FrameUniforms {
+  glm::mat4 view;
+  glm::mat4 projection;
 };
+constexpr unsigned int kFrameBinding = 0;
 
+// Built at compile time, with each face mapping the whole texture.
+constexpr auto kCube = MakeCube();
+
+// clang-format off
 glm::vec3 cubePositions[] = {
     glm::vec3( 0.0f,  0.0f,  0.0f),
     glm::vec3( 2.0f,  5.0f, -15.0f),
@@ -73,93 +55,127 @@ glm::vec3 cubePositions[] = {
 // };
 // clang-format on
 
-void setupVertexArrayObject(unsigned int &VAO, unsigned int &VBO /*, unsigned int &EBO*/) {
-  glGenVertexArrays(1, &VAO);
-  glGenBuffers(1, &VBO);
-  // glGenBuffers(1, &EBO);
-
-  // 1. Bind Vertex Array Object.
-  glBindVertexArray(VAO);
-
-  // 2. Copy our vertices array into a buffer for OpenGL to use.
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-  // Copy our index array into an element buffer for OpenGL to use.
-  // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  // glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-  // 3. Then set our vertex attribute pointers.
-  // Position attribute:
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), nullptr);
-  glEnableVertexAttribArray(0);
-  // // Color attribute:
-  // glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 *
-  // sizeof(float))); glEnableVertexAttribArray(1); Texture attribute:
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));
-  glEnableVertexAttribArray(1);
-
-  // Unbind the VBO. Note that this is allowed, the call to glVertexAttribPointer registered VBO
-  // as the vertex attribute's bound vertex buffer object so afterwards we can safely unbind.
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Unbind the VAO. You can unbind the VAO afterwards so other VAO calls won't accidentally
-  // modify this VAO, but this rarely happens. Modifying other VAOs requires a call to
-  // glBindVertexArray anyway, so we generally don't unbind VAOs (nor VBOs) when it's not
-  // directly necessary.
-  glBindVertexArray(0);
-
-  // Unbind the EBO. This must come after unbinding the VAO since a bound VAO stores binds and
-  // unbinds of GL_ELEMENT_ARRAY_BUFFER.
-  // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-}
-
-int main() {
-  auto app = GlfwApplication::Create();
+int main(int argc, char **argv) {
+  auto app = GlfwApplication::Create(GlfwApplication::ParseOptions(argc, argv));
 
+  // Compile in the background while the textures below are decoded.
   Shader shader("/Users/kal/Code/learnopengl/vertex_shader.glsl",
-                "/Users/kal/Code/learnopengl/fragment_shader.glsl");
-
-  unsigned int texture1;
-  glGenTextures(1, &texture1);
-  glBindTexture(GL_TEXTURE_2D, texture1);
-  // set the texture wrapping/filtering options (on the currently bound texture object)
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  // load and generate the texture
-  int width, height, nrChannels;
-  unsigned char *data =
-      stbi_load("/Users/kal/Code/learnopengl/container.jpeg", &width, &height, &nrChannels, 0);
-  if (data) {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-  } else {
-    std::cout << "Failed to load container texture" << std::endl;
+                "/Users/kal/Code/learnopengl/fragment_shader.glsl", Shader::kAsync);
+
+  // Prefer textures precooked with cook_texture, which upload straight from a file mapping.
+  // Otherwise decode and block compress the source images in the background; they show a
+  // placeholder until Update() uploads them.
+  TextureLoader loader(/*threads=*/0, /*compress=*/true);
+  unsigned int texture1 = LoadTextureFile("/Users/kal/Code/learnopengl/container.tex");
+  if (texture1 == 0) {
+    texture1 = loader.Load("/Users/kal/Code/learnopengl/container.jpeg");
+  }
+  unsigned int texture2 = LoadTextureFile("/Users/kal/Code/learnopengl/awesomeface.tex");
+  if (texture2 == 0) {
+    texture2 = loader.Load("/Users/kal/Code/learnopengl/awesomeface.png", /*flip_vertically=*/true);
+  }
+
+  IndexedMesh<MeshVertex> cube = kCube.ToIndexedMesh();
+  VertexCacheStatistics statistics = OptimizeMesh(cube);
+  if (app->Stats()) {
+    std::cout << "Cube: " << cube.vertices.size() << " vertices, ACMR " << statistics.acmr
+              << ", ATVR " << statistics.atvr << std::endl;
   }
-  stbi_image_free(data);
-
-  unsigned int texture2;
-  glGenTextures(1, &texture2);
-  glBindTexture(GL_TEXTURE_2D, texture2);
-  // set the texture wrapping/filtering options (on the currently bound texture object)
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  stbi_set_flip_vertically_on_load(true);
-  data = stbi_load("/Users/kal/Code/learnopengl/awesomeface.png", &width, &height, &nrChannels, 0);
-  if (data) {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-  } else {
-    std::cout << "Failed to load awesomeface texture" << std::endl;
+
+  // The cubes never move, so they are transformed into world space once and merged into a single
+  // mesh, drawn with one call. Quantized positions would not survive that, so they stay floats;
+  // the moving shapes below are the ones quantized.
+  constexpr uint32_t kCrateMaterial = 0;
+  StaticBatcher<MeshVertex> batcher(64 * 1024, 256 * 1024);
+  // Every object in the scene, with its box in model space and its model matrix: the cubes first,
+  // numbered as the batcher numbers them, which counts up from zero, then the shapes below.
+  auto mesh_bounds = [](const IndexedMesh<MeshVertex> &mesh) {
+    Aabb bounds;
+    for (const MeshVertex &vertex : mesh.vertices) {
+      bounds.Grow(vertex.position);
+    }
+    return bounds;
+  };
+  std::vector<Aabb> local_bounds;
+  std::vector<glm::mat4> object_models;
+  for (unsigned int i = 0; i < sizeof(cubePositions) / sizeof(cubePositions[0]); i++) {
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, cubePositions[i]);
+    float angle = 20.f * i;
+    model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+    batcher.Add(cube, model, kCrateMaterial);
+    local_bounds.push_back(mesh_bounds(cube));
+    object_models.push_back(model);
+  }
+  uint32_t cube_count = (uint32_t)object_models.size();
+  if (!batcher.Update()) {
+    return EXIT_FAILURE;
   }
-  stbi_image_free(data);
 
-  unsigned int VAO, VBO; //, EBO;
-  setupVertexArrayObject(VAO, VBO /*, EBO*/);
+  // Procedural shapes circle the crates, several copies of each. They move every frame, so each
+  // copy reads its model matrix from the ring buffer, found through the command's base instance,
+  // and the whole ring is one multi-draw. Each shape's simpler versions follow it in its index
+  // buffer, and each copy draws the coarsest one that stays within a pixel of the full shape.
+  // Their vertices are packed to 16 bytes, with positions relative to each shape's bounds.
+  constexpr uint32_t kShapeCopies = 4;
+  struct Shape {
+    PooledMesh mesh;
+    std::vector<LodLevel> lods;
+    BoundingSphere sphere;
+    glm::mat4 dequantization;
+  };
+  MeshPool<PackedMeshVertex> shape_pool(256 * 1024, 1024 * 1024);
+  std::vector<Shape> shapes;
+  std::vector<Aabb> shape_bounds;
+  std::vector<IndexedMesh<MeshVertex>> generated = {GenerateUvSphere(32, 16), GenerateIcosphere(4),
+                                                    GenerateTorus(48, 24), GenerateCylinder(32),
+                                                    GenerateCube(4)};
+  for (IndexedMesh<MeshVertex> &shape : generated) {
+    std::vector<LodLevel> lods = BuildLodChain(shape);
+    PackedMesh packed = PackMesh(shape);
+    if (std::optional<PooledMesh> pooled =
+            shape_pool.Add(packed.vertices.data(), packed.vertices.size(), shape.indices.data(),
+                           shape.indices.size())) {
+      BoundingSphere sphere = ComputeBoundingSphere(&shape.vertices[0].position.x,
+                                                    shape.vertices.size(), sizeof(MeshVertex));
+      shapes.push_back(
+          {*pooled, std::move(lods), sphere, packed.quantization.DequantizationMatrix()});
+      shape_bounds.push_back(mesh_bounds(shape));
+    }
+  }
+  DrawList shape_draws(shape_pool);
+  if (app->Stats()) {
+    std::cout << "Shapes: " << shapes.size() * kShapeCopies << " objects in "
+              << (DrawList::Indirect() ? "one multi-draw" : "a loop of draws") << std::endl;
+  }
+
+  // Everything that changes per frame is written straight into this buffer.
+  size_t shape_count = shapes.size() * kShapeCopies;
+  RingBuffer ring(sizeof(FrameUniforms) + shape_count * sizeof(glm::mat4));
+
+  auto shape_model = [&](uint32_t instance, float time) {
+    float angle = time * 0.25f + glm::radians(360.0f) * instance / shape_count;
+    glm::mat4 model = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f));
+    model = glm::translate(model, glm::vec3(0.0f, 0.0f, 6.0f));
+    return glm::rotate(model, time, glm::vec3(1.0f, 0.3f, 0.5f));
+  };
+  for (uint32_t instance = 0; instance < shape_count; instance++) {
+    local_bounds.push_back(shape_bounds[instance / kShapeCopies]);
+    object_models.push_back(shape_model(instance, 0.0f));
+  }
+
+  // The scene's world space boxes in a tree, for culling and picking. The shapes' boxes are
+  // refitted as they move; they circle back to where they started, so the tree stays a good fit.
+  std::vector<Aabb> world_bounds;
+  for (size_t object = 0; object < object_models.size(); object++) {
+    world_bounds.push_back(local_bounds[object].Transformed(object_models[object]));
+  }
+  Bvh scene;
+  scene.Build(world_bounds);
+  std::vector<uint32_t> visible_objects;
+  std::vector<uint8_t> visible(object_models.size());
+  constexpr uint32_t kNoObject = ~0u;
+  uint32_t looking_at = kNoObject;
 
   glEnable(GL_DEPTH_TEST);
 
@@ -193,7 +209,24 @@ int main() {
 
   app->OnScroll([&]([[maybe_unused]] double x, double y) { camera.ProcessMouseScroll(y); });
 
+  // Resolve uniforms once up front rather than by name on every draw.
+  Shader::Uniform texture1_uniform = shader.uniform("texture1");
+  Shader::Uniform texture2_uniform = shader.uniform("texture2");
+  shader.bindUniformBlock("Frame", kFrameBinding);
+  // Samplers are program state, so they are set once rather than every frame.
+  shader.use();
+  shader.setInt(texture1_uniform, 0);
+  shader.setInt(texture2_uniform, 1);
+
+  // The crates and the shapes swap textures. The queue binds each material's textures, the
+  // program and the vertex arrays only when they differ from the previous draw's.
+  RenderQueue queue;
+  uint32_t crate_material = queue.AddMaterial({{texture1, texture2}});
+  uint32_t shape_material = queue.AddMaterial({{texture2, texture1}});
+
   app->Run([&]() {
+    loader.Update();
+
     float currentFrame = glfwGetTime();
     delta_time = currentFrame - lastFrame;
     lastFrame = currentFrame;
@@ -201,40 +234,122 @@ int main() {
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture1);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, texture2);
-
-    // Activate the shader before setting the uniform.
-    shader.use();
-    shader.setInt("texture1", 0);
-    shader.setInt("texture2", 1);
-
-    glm::mat4 projection =
-        glm::perspective(glm::radians(camera.Zoom()), 800.0f / 600.0f, 0.1f, 100.0f);
-    shader.set("projection", projection);
-
-    glm::mat4 view = camera.ViewMatrix();
-    shader.set("view", view);
-
-    glBindVertexArray(VAO);
-    // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    // glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-    for (unsigned int i = 0; i < 10; i++) {
-      glm::mat4 model = glm::mat4(1.0f);
-      model = glm::translate(model, cubePositions[i]);
-      float angle = 20.f * i;
-      model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-      shader.set("model", model);
-
-      glDrawArrays(GL_TRIANGLES, 0, 36);
+    ring.BeginFrame();
+    RingBuffer::Allocation frame = ring.Allocate(sizeof(FrameUniforms), ring.UniformAlignment());
+    RingBuffer::Allocation models = ring.Allocate(shape_count * sizeof(glm::mat4));
+    if (frame.data == nullptr || models.data == nullptr) {
+      // Allocate has reported it; drawing without the frame's data would read stale matrices.
+      ring.EndFrame();
+      return;
+    }
+    FrameUniforms uniforms = {camera.ViewMatrix(), glm::perspective(glm::radians(camera.Zoom()),
+                                                                    800.0f / 600.0f, 0.1f, 100.0f)};
+    std::memcpy(frame.data, &uniforms, sizeof(uniforms));
+    glBindBufferRange(GL_UNIFORM_BUFFER, kFrameBinding, ring.Buffer(), frame.offset,
+                      sizeof(uniforms));
+    for (uint32_t instance = 0; instance < shape_count; instance++) {
+      uint32_t object = cube_count + instance;
+      object_models[object] = shape_model(instance, currentFrame);
+      // The model matrix the shader sees also maps the packed positions back to model space.
+      static_cast<glm::mat4 *>(models.data)[instance] =
+          object_models[object] * shapes[instance / kShapeCopies].dequantization;
+      scene.Update(object, local_bounds[object].Transformed(object_models[object]));
+    }
+
+    visible_objects.clear();
+    scene.Cull(Frustum(uniforms.projection * uniforms.view), &visible_objects);
+    std::fill(visible.begin(), visible.end(), 0);
+    for (uint32_t object : visible_objects) {
+      visible[object] = 1;
+    }
+
+    // The cursor is captured, so what is picked, reported with --stats, is what is in the middle
+    // of the screen. Each box is tested in its object's own space, where it fits tightly.
+    glm::vec3 eye = camera.Position(), ray = camera.RayThrough(0.0f, 0.0f, 800.0f / 600.0f);
+    std::optional<Bvh::RayHit> hit =
+        scene.Raycast(eye, ray, 100.0f, [&](uint32_t object, float) -> std::optional<float> {
+          glm::mat4 inverse = glm::inverse(object_models[object]);
+          glm::vec3 local_eye = glm::vec3(inverse * glm::vec4(eye, 1.0f));
+          glm::vec3 local_ray = glm::mat3(inverse) * ray;
+          float distance = local_bounds[object].RayEntry(local_eye, 1.0f / local_ray);
+          return std::isinf(distance) ? std::nullopt : std::optional<float>(distance);
+        });
+    if ((hit ? hit->object : kNoObject) != looking_at) {
+      looking_at = hit ? hit->object : kNoObject;
+      if (hit && app->Stats()) {
+        std::cout << "Looking at " << (hit->object < cube_count ? "crate " : "shape ")
+                  << (hit->object < cube_count ? hit->object : hit->object - cube_count) << ", "
+                  << hit->distance << " away" << std::endl;
+      }
+    }
+
+    // Only the copies in view are drawn, each run of them at the same level one command.
+    shape_draws.Clear();
+    for (uint32_t shape = 0; shape < shapes.size(); shape++) {
+      const Shape &drawn = shapes[shape];
+      uint32_t run = 0;
+      size_t run_lod = 0;
+      for (uint32_t copy = 0; copy <= kShapeCopies; copy++) {
+        uint32_t instance = shape * kShapeCopies + copy;
+        bool in_view = copy < kShapeCopies && visible[cube_count + instance];
+        size_t lod = 0;
+        if (in_view) {
+          glm::vec3 center = glm::vec3(object_models[cube_count + instance] *
+                                       glm::vec4(drawn.sphere.center, 1.0f));
+          lod = SelectLod(drawn.lods, center, drawn.sphere.radius, 1.0f, camera, 600.0f);
+        }
+        if (run > 0 && (!in_view || lod != run_lod)) {
+          const LodLevel &level = drawn.lods[run_lod];
+          shape_draws.Add(drawn.mesh, level.first_index, level.index_count, instance - run, run);
+          run = 0;
+        }
+        if (in_view) {
+          run_lod = lod;
+          run++;
+        }
+      }
+    }
+    shape_draws.SetInstances(ring.Buffer(), models.offset);
+    shape_draws.Upload();
+    ring.Flush();
+
+    // Update() rebuilds only if cubes were added or removed since the last frame.
+    batcher.Update();
+    queue.Clear();
+    for (const auto &[material, batch] : batcher.Batches()) {
+      // Only the cubes in view are drawn. Cubes next to each other in the batch are next to each
+      // other in the index buffer, so runs of visible ones still make a single draw.
+      RenderQueue::State state = {0, shader.ID, crate_material, batcher.Pool().Vao()};
+      RenderQueue::Draw whole = RenderQueue::Draw::Pooled(batcher.Pool(), batch.mesh);
+      RenderQueue::Draw draw = whole;
+      draw.count = 0;
+      for (const StaticBatcher<MeshVertex>::BatchObject &object : batch.objects) {
+        if (!visible[object.id]) {
+          continue;
+        }
+        uint32_t first = whole.first + object.indices.first;
+        if (draw.count > 0 && draw.first + draw.count != first) {
+          queue.Add(state, draw);
+          draw.count = 0;
+        }
+        if (draw.count == 0) {
+          draw.first = first;
+        }
+        draw.count += object.indices.count;
+      }
+      if (draw.count > 0) {
+        queue.Add(state, draw);
+      }
     }
+    queue.Add({0, shader.ID, shape_material, shape_draws.Vao()},
+              RenderQueue::Draw::List(shape_draws));
+    queue.Replay();
+    ring.EndFrame();
 
     //////////////////////////////////////////////////
     glBindVertexArray(0);
   });
 
-  glDeleteVertexArrays(1, &VAO);
-  glDeleteBuffers(1, &VBO);
+  glDeleteTextures(1, &texture1);
+  glDeleteTextures(1, &texture2);
 }
\ No newline at end of file
@@ -0,0 +1,199 @@
+#include "vertex_quantization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+template <typename In, typename Out, typename Encode>
+void encodeStrided(const In *input, size_t stride, size_t count, Out *output,
+                   size_t output_stride, Encode encode) {
+  const auto *in = reinterpret_cast<const unsigned char *>(input);
+  auto *out = reinterpret_cast<unsigned char *>(output);
+  for (size_t i = 0; i < count; i++) {
+    encode(*reinterpret_cast<const In *>(in + i * stride),
+           *reinterpret_cast<Out *>(out + i * output_stride));
+  }
+}
+
+// Clamps four values to [low, high], scales them and rounds to the nearest integer (ties to even
+// on both the SSE2 and scalar paths). Every fixed-point encoder goes through this.
+struct Quantized {
+  int32_t value[4];
+};
+
+Quantized quantize(const float value[4], const float scale[4], float low, float high) {
+  Quantized result;
+#if defined(__SSE2__)
+  __m128 v = _mm_loadu_ps(value);
+  v = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(low)), _mm_set1_ps(high));
+  __m128i q = _mm_cvtps_epi32(_mm_mul_ps(v, _mm_loadu_ps(scale)));
+  _mm_storeu_si128((__m128i *)result.value, q);
+#else
+  for (int i = 0; i < 4; i++) {
+    float v = std::min(std::max(value[i], low), high);
+    result.value[i] = (int32_t)std::nearbyint(v * scale[i]);
+  }
+#endif
+  return result;
+}
+
+#if !defined(__F16C__)
+// Round to nearest even, after "float_to_half_fast3_rtne" by Fabian Giesen.
+uint16_t floatToHalf(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  uint32_t sign = bits & 0x80000000u;
+  bits ^= sign;
+
+  uint32_t half;
+  if (bits >= (127u + 16u) << 23) {
+    // Too large, infinity or NaN.
+    half = bits > 255u << 23 ? 0x7e00 : 0x7c00;
+  } else if (bits < 113u << 23) {
+    // Subnormal or zero: let the FPU align the mantissa by adding a power of two.
+    constexpr uint32_t kDenormMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+    float magic, shifted;
+    std::memcpy(&magic, &kDenormMagic, sizeof(magic));
+    std::memcpy(&shifted, &bits, sizeof(shifted));
+    shifted += magic;
+    std::memcpy(&half, &shifted, sizeof(half));
+    half -= kDenormMagic;
+  } else {
+    uint32_t mantissa_odd = (bits >> 13) & 1;
+    bits -= (127u - 15u) << 23;
+    bits += 0xfff + mantissa_odd;
+    half = bits >> 13;
+  }
+  return (uint16_t)(half | (sign >> 16));
+}
+#endif
+
+} // namespace
+
+glm::mat4 PositionQuantization::DequantizationMatrix() const {
+  glm::mat4 matrix(1.0f);
+  matrix[0][0] = scale.x;
+  matrix[1][1] = scale.y;
+  matrix[2][2] = scale.z;
+  matrix[3] = glm::vec4(offset, 1.0f);
+  return matrix;
+}
+
+PositionQuantization ComputePositionQuantization(const glm::vec3 *positions, size_t stride,
+                                                 size_t count) {
+  PositionQuantization quantization;
+  if (count == 0) {
+    return quantization;
+  }
+  glm::vec3 low(std::numeric_limits<float>::max());
+  glm::vec3 high(std::numeric_limits<float>::lowest());
+  const auto *bytes = reinterpret_cast<const unsigned char *>(positions);
+  for (size_t i = 0; i < count; i++) {
+    const auto &position = *reinterpret_cast<const glm::vec3 *>(bytes + i * stride);
+    low = glm::min(low, position);
+    high = glm::max(high, position);
+  }
+  quantization.offset = (low + high) * 0.5f;
+  quantization.scale = (high - low) * 0.5f;
+  // A flat axis still needs an invertible scale.
+  for (int axis = 0; axis < 3; axis++) {
+    if (quantization.scale[axis] <= 0.0f) {
+      quantization.scale[axis] = 1.0f;
+    }
+  }
+  return quantization;
+}
+
+void EncodePositions(const PositionQuantization &quantization, const glm::vec3 *positions,
+                     size_t stride, size_t count, Snorm16x4 *output, size_t output_stride) {
+  const glm::vec3 offset = quantization.offset;
+  const glm::vec3 inverse_scale = 1.0f / quantization.scale;
+  const float scale[4] = {32767.0f, 32767.0f, 32767.0f, 0.0f};
+  encodeStrided(positions, stride, count, output, output_stride,
+                [&](const glm::vec3 &position, Snorm16x4 &packed) {
+                  glm::vec3 normalized = (position - offset) * inverse_scale;
+                  float value[4] = {normalized.x, normalized.y, normalized.z, 0.0f};
+                  Quantized q = quantize(value, scale, -1.0f, 1.0f);
+                  for (int i = 0; i < 4; i++) {
+                    packed.value[i] = (int16_t)q.value[i];
+                  }
+                });
+}
+
+void EncodePositions(const glm::vec3 *positions, size_t stride, size_t count, Half4 *output,
+                     size_t output_stride) {
+  encodeStrided(positions, stride, count, output, output_stride,
+                [](const glm::vec3 &position, Half4 &packed) {
+#if defined(__F16C__)
+                  __m128 value = _mm_setr_ps(position.x, position.y, position.z, 1.0f);
+                  __m128i half = _mm_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT);
+                  _mm_storel_epi64((__m128i *)packed.value, half);
+#else
+                  packed.value[0] = floatToHalf(position.x);
+                  packed.value[1] = floatToHalf(position.y);
+                  packed.value[2] = floatToHalf(position.z);
+                  packed.value[3] = floatToHalf(1.0f);
+#endif
+                });
+}
+
+void EncodeNormals(const glm::vec3 *normals, size_t stride, size_t count, PackedNormal *output,
+                   size_t output_stride) {
+  const float scale[4] = {511.0f, 511.0f, 511.0f, 0.0f};
+  encodeStrided(normals, stride, count, output, output_stride,
+                [&](const glm::vec3 &normal, PackedNormal &packed) {
+                  float value[4] = {normal.x, normal.y, normal.z, 0.0f};
+                  Quantized q = quantize(value, scale, -1.0f, 1.0f);
+                  packed.bits = ((uint32_t)q.value[0] & 0x3ff) |
+                                (((uint32_t)q.value[1] & 0x3ff) << 10) |
+                                (((uint32_t)q.value[2] & 0x3ff) << 20);
+                });
+}
+
+void EncodeTexCoords(const glm::vec2 *tex_coords, size_t stride, size_t count, Unorm16x2 *output,
+                     size_t output_stride) {
+  const float scale[4] = {65535.0f, 65535.0f, 0.0f, 0.0f};
+  encodeStrided(tex_coords, stride, count, output, output_stride,
+                [&](const glm::vec2 &tex_coord, Unorm16x2 &packed) {
+                  float value[4] = {tex_coord.x, tex_coord.y, 0.0f, 0.0f};
+                  Quantized q = quantize(value, scale, 0.0f, 1.0f);
+                  packed.value[0] = (uint16_t)q.value[0];
+                  packed.value[1] = (uint16_t)q.value[1];
+                });
+}
+
+void EncodeColors(const glm::vec3 *colors, size_t stride, size_t count, Unorm8x4 *output,
+                  size_t output_stride) {
+  const float scale[4] = {255.0f, 255.0f, 255.0f, 255.0f};
+  encodeStrided(colors, stride, count, output, output_stride,
+                [&](const glm::vec3 &color, Unorm8x4 &packed) {
+                  float value[4] = {color.x, color.y, color.z, 1.0f};
+                  Quantized q = quantize(value, scale, 0.0f, 1.0f);
+                  for (int i = 0; i < 4; i++) {
+                    packed.value[i] = (uint8_t)q.value[i];
+                  }
+                });
+}
+
+void EncodeColors(const glm::vec4 *colors, size_t stride, size_t count, Unorm8x4 *output,
+                  size_t output_stride) {
+  const float scale[4] = {255.0f, 255.0f, 255.0f, 255.0f};
+  encodeStrided(colors, stride, count, output, output_stride,
+                [&](const glm::vec4 &color, Unorm8x4 &packed) {
+                  float value[4] = {color.x, color.y, color.z, color.w};
+                  Quantized q = quantize(value, scale, 0.0f, 1.0f);
+                  for (int i = 0; i < 4; i++) {
+                    packed.value[i] = (uint8_t)q.value[i];
+                  }
+                });
+}
@@ -0,0 +1,88 @@
+#ifndef LEARNOPENGL_VERTEX_QUANTIZATION_H
+#define LEARNOPENGL_VERTEX_QUANTIZATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+
+// Packed attribute types for vertex structs. Four-component types keep attributes 4-byte aligned;
+// a vec3 shader input ignores the fourth component.
+
+/** Signed normalized 16-bit, used for positions relative to a PositionQuantization. */
+struct Snorm16x4 {
+  int16_t value[4];
+};
+
+/** IEEE half floats, for positions that need no dequantization. */
+struct Half4 {
+  uint16_t value[4];
+};
+
+/** A signed normalized vector packed into 10:10:10:2 bits. */
+struct PackedNormal {
+  uint32_t bits;
+};
+
+/** Unsigned normalized 16-bit texture coordinates, covering [0, 1] only. */
+struct Unorm16x2 {
+  uint16_t value[2];
+};
+
+/** Unsigned normalized 8-bit RGBA. */
+struct Unorm8x4 {
+  uint8_t value[4];
+};
+
+template <>
+struct AttributeFormat<Snorm16x4> : AttributeFormatOf<GL_SHORT, 4, true> {};
+template <>
+struct AttributeFormat<Half4> : AttributeFormatOf<GL_HALF_FLOAT, 4> {};
+template <>
+struct AttributeFormat<PackedNormal> : AttributeFormatOf<GL_INT_2_10_10_10_REV, 4, true> {};
+template <>
+struct AttributeFormat<Unorm16x2> : AttributeFormatOf<GL_UNSIGNED_SHORT, 2, true> {};
+template <>
+struct AttributeFormat<Unorm8x4> : AttributeFormatOf<GL_UNSIGNED_BYTE, 4, true> {};
+
+/**
+ * Maps a mesh's bounding box onto the [-1, 1] range of snorm16 positions. The original position
+ * is offset + scale * quantized, which DequantizationMatrix() expresses as a model transform.
+ */
+struct PositionQuantization {
+  glm::vec3 offset = glm::vec3(0.0f);
+  glm::vec3 scale = glm::vec3(1.0f);
+
+  glm::mat4 DequantizationMatrix() const;
+};
+
+// The encoders below read count elements stride bytes apart and write them output_stride bytes
+// apart, so they can convert one member of an array of vertex structs into another in place.
+// Each element is converted with SSE2 when available.
+
+PositionQuantization ComputePositionQuantization(const glm::vec3 *positions, size_t stride,
+                                                 size_t count);
+
+void EncodePositions(const PositionQuantization &quantization, const glm::vec3 *positions,
+                     size_t stride, size_t count, Snorm16x4 *output, size_t output_stride);
+
+/** Rounds to the nearest half float; magnitudes beyond 65504 become infinity. */
+void EncodePositions(const glm::vec3 *positions, size_t stride, size_t count, Half4 *output,
+                     size_t output_stride);
+
+/** Expects unit-length normals; the 2-bit fourth component is zero. */
+void EncodeNormals(const glm::vec3 *normals, size_t stride, size_t count, PackedNormal *output,
+                   size_t output_stride);
+
+/** Clamps to [0, 1], so meshes that rely on repeating coordinates need float UVs. */
+void EncodeTexCoords(const glm::vec2 *tex_coords, size_t stride, size_t count, Unorm16x2 *output,
+                     size_t output_stride);
+
+/** Opaque colors: alpha is set to 255. */
+void EncodeColors(const glm::vec3 *colors, size_t stride, size_t count, Unorm8x4 *output,
+                  size_t output_stride);
+void EncodeColors(const glm::vec4 *colors, size_t stride, size_t count, Unorm8x4 *output,
+                  size_t output_stride);
+
+#endif // LEARNOPENGL_VERTEX_QUANTIZATION_H
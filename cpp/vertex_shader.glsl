@@ -1,14 +1,18 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
+// Per-instance model matrix; occupies locations 2 through 5.
+layout (location = 2) in mat4 aModel;
 
 out vec2 TexCoord;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Written once per frame into a RingBuffer rather than set uniform by uniform.
+layout (std140) uniform Frame {
+  mat4 view;
+  mat4 projection;
+};
 
 void main() {
-  gl_Position = projection * view * model * vec4(aPos, 1.0);
+  gl_Position = projection * view * aModel * vec4(aPos, 1.0);
   TexCoord = vec2(aTexCoord.x, aTexCoord.y);
 }
\ No newline at end of file